@@ -19,6 +19,10 @@
  * See the License for the specific language governing permissions and limitations under the License.
  */
 
+/* following macro is necessary for recvmmsg() function call (sockets) */
+#define _GNU_SOURCE
+
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -27,7 +31,12 @@
 #include <linux/can/raw.h>
 #include <linux/can/error.h>
 #include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include <linux/filter.h>
 #include <sys/socket.h>
+#include <sys/ioctl.h>
 #include <asm/socket.h>
 #include <sys/eventfd.h>
 #include <time.h>
@@ -40,10 +49,583 @@ pthread_mutex_t CO_EMCY_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t CO_OD_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
-#if CO_DRIVER_MULTI_INTERFACE == 0
-static CO_ReturnError_t CO_CANmodule_addInterface(CO_CANmodule_t* CANmodule, int can_ifindex);
+static CO_ReturnError_t CO_CANaddInterface(CO_CANmodule_t* CANmodule, int can_ifindex);
+
+/* Size of ancillary data buffer for one received CAN message: timestamp and rx queue overflow counter */
+#define CO_CAN_CTRLMSG_SIZE (CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(uint32_t)))
+
+/* Size of ancillary data buffer for launch time of one sent CAN message */
+#define CO_CAN_TXTIME_CMSG_SIZE CMSG_SPACE(sizeof(uint64_t))
+
+/* Offset between raw hardware and monotonic clock is the minimum difference seen within this window */
+#define CO_CAN_TIMESTAMP_WINDOW_NS 1000000000LL
+
+/* Clock values sampled once per read from socket, used to convert rx timestamps into CLOCK_MONOTONIC */
+typedef struct {
+    int64_t mono_ns;       /* CLOCK_MONOTONIC after the read */
+    int64_t realToMono_ns; /* Added to CLOCK_REALTIME gives CLOCK_MONOTONIC */
+} CO_CANclockSample_t;
+
+/* CAN message, as read from socket */
+#if CO_DRIVER_CANFD > 0
+typedef struct canfd_frame CO_CANframe_t;
+#else
+typedef struct can_frame CO_CANframe_t;
 #endif
 
+/* Received number of bytes is valid classical CAN or, if enabled, CAN FD frame */
+static inline bool_t
+CO_CANrxMtuValid(ssize_t n) {
+#if CO_DRIVER_CANFD > 0
+    return n == CAN_MTU || n == CANFD_MTU;
+#else
+    return n == CAN_MTU;
+#endif
+}
+
+/* Older kernels do not set CANFD_FDF flag in received CAN FD frame */
+static inline void
+CO_CANrxSetFdFlag(CO_CANframe_t* msg, ssize_t n) {
+#if CO_DRIVER_CANFD > 0
+    if (n == CANFD_MTU) {
+        msg->flags |= CANFD_FDF;
+    }
+#else
+    (void)msg;
+    (void)n;
+#endif
+}
+
+/* Number of bytes to send for tx buffer: classical or CAN FD frame */
+static inline ssize_t
+CO_CANtxMtu(const CO_CANtx_t* buffer) {
+#if CO_DRIVER_CANFD > 0
+    return (buffer->DLC > CAN_MAX_DLEN || (buffer->flags & CANFD_FDF) != 0) ? CANFD_MTU : CAN_MTU;
+#else
+    (void)buffer;
+    return CAN_MTU;
+#endif
+}
+
+#if CO_DRIVER_RX_BATCH > 1
+/* Preallocated buffers for reading multiple CAN messages with single recvmmsg() call */
+struct CO_CANrxBatch {
+    struct mmsghdr msgs[CO_DRIVER_RX_BATCH];
+    struct iovec iov[CO_DRIVER_RX_BATCH];
+    CO_CANframe_t frames[CO_DRIVER_RX_BATCH];
+    char ctrlmsg[CO_DRIVER_RX_BATCH][CO_CAN_CTRLMSG_SIZE];
+};
+#endif
+
+/* Copy of tx message, which waits in the driver. CO_CANsend() copies the tx buffer, so it may be changed or sent
+ * again, while the copy waits in a ring, staging queue or tx queue. */
+struct CO_CANtxEntry {
+    CO_CANtx_t buffer; /* frame data, syncFlag and can_ifindex of the tx buffer, bufferFull is not used */
+    uint16_t index;    /* txArray index of the tx buffer */
+    int64_t send_ns;   /* CLOCK_MONOTONIC time of CO_CANsend() call, if tx latency is measured */
+};
+
+#if CO_DRIVER_TX_BATCH > 1
+/* Staging queue of one interface for writing multiple CAN messages with single sendmmsg() call */
+struct CO_CANtxBatch {
+    struct mmsghdr msgs[CO_DRIVER_TX_BATCH];
+    struct iovec iov[CO_DRIVER_TX_BATCH];
+    struct CO_CANtxEntry entries[CO_DRIVER_TX_BATCH];
+    uint64_t txtime[CO_DRIVER_TX_BATCH]; /* SO_TXTIME launch time of each staged message, 0 if none */
+    char ctrlmsg[CO_DRIVER_TX_BATCH][CO_CAN_TXTIME_CMSG_SIZE];
+    uint32_t count; /* number of staged messages */
+};
+#endif
+
+/* Position of tx buffer, which is not in CO_CANtxQueue */
+#define CO_CAN_TX_NOT_QUEUED 0xFFFFU
+
+/* Tx buffers, which could not be written to the socket of one interface. Binary heap of txArray indexes ordered by CAN
+ * identifier of the queued copy, so messages are retried in CANopen priority order: NMT, SYNC, EMCY, PDO, SDO, ... */
+struct CO_CANtxQueue {
+    uint16_t count;
+    uint16_t* heap;     /* txArray indexes, heap[0] has the lowest identifier */
+    uint16_t* position; /* index in heap for each txArray index or CO_CAN_TX_NOT_QUEUED */
+    uint8_t* deferred;  /* for each txArray index, true if queued message is already counted as deferred by shaper */
+    struct CO_CANtxEntry entries[]; /* queued copy for each txArray index, txSize, followed by heap, position and
+                                       deferred */
+};
+
+#ifndef CO_SINGLE_THREAD
+/* State of CO_CANtxRing */
+#define CO_CAN_TX_RING_FREE     0U
+#define CO_CAN_TX_RING_CLAIMING 1U
+#define CO_CAN_TX_RING_OWNED    2U
+
+/* Messages sent by one thread other than the tx consumer, see CO_DRIVER_TX_PRODUCERS. Single producer, single consumer
+ * ring: only the owner writes entries and tail, only the consumer reads entries and writes head. */
+struct CO_CANtxRing {
+    uint32_t state;  /* CO_CAN_TX_RING_*, ring is claimed by the first CO_CANsend() of the thread */
+    pthread_t owner; /* producer thread, valid in CO_CAN_TX_RING_OWNED state */
+    uint32_t head;   /* free running index of the oldest entry */
+    uint32_t tail;   /* free running index of the next free entry */
+    struct CO_CANtxEntry entries[CO_DRIVER_TX_RING];
+};
+#endif
+
+/* Size of the FIFO of sent messages, which wait for their tx timestamp, per interface. If timestamps do not arrive, the
+ * oldest entries are overwritten. */
+#define CO_CAN_TX_STAMP_FIFO 256U
+
+/* No slot in CO_CANtxStamps for the identifier */
+#define CO_CAN_TX_STAMP_NONE 0xFFFFU
+
+/* Messages written to the socket of one interface, in order, which wait for tx timestamp from socket error queue */
+struct CO_CANtxStampFifo {
+    uint32_t head;  /* index of the oldest entry */
+    uint32_t count; /* number of entries */
+    struct {
+        uint32_t ident;  /* CAN identifier with flags, as in can_id */
+        int64_t send_ns; /* CLOCK_MONOTONIC time of CO_CANsend() call */
+    } entries[CO_CAN_TX_STAMP_FIFO];
+};
+
+/* Tx latency measurement, see CO_CANmodule_getTxLatency() */
+struct CO_CANtxStamps {
+    uint16_t slot[CO_CAN_MSG_SFF_MAX_COB_ID]; /* index in latency for each 11-bit identifier */
+    uint16_t count;                           /* number of used entries in latency */
+    uint16_t size;                            /* number of allocated entries in latency, txSize */
+    CO_CANtxLatency_t latency[];
+};
+
+/* Tx work, done by CO_CANtxProcess() */
+#define CO_CAN_TX_REQ_RETRY 0x01U /* re-send unsent messages, socket may be writable again */
+#define CO_CAN_TX_REQ_PURGE 0x02U /* remove synchronous messages, see CO_CANclearPendingSyncPDOs() */
+#define CO_CAN_TX_REQ_FLUSH 0x04U /* write staged messages, see CO_CANmodule_txFlush() */
+
+/* Lock tx latency statistics, they are updated by the tx consumer and read by CO_CANmodule_getTxLatency() from any
+ * thread */
+static inline void
+CO_CANtxStampLock(CO_CANmodule_t* CANmodule) {
+#ifndef CO_SINGLE_THREAD
+    (void)pthread_mutex_lock(&CANmodule->txStampMutex);
+#else
+    (void)CANmodule;
+#endif
+}
+
+static inline void
+CO_CANtxStampUnlock(CO_CANmodule_t* CANmodule) {
+#ifndef CO_SINGLE_THREAD
+    (void)pthread_mutex_unlock(&CANmodule->txStampMutex);
+#else
+    (void)CANmodule;
+#endif
+}
+
+/* Calling thread is the tx consumer, which writes to CAN sockets and owns tx queues, see CO_CANmodule_txConsumer() */
+static inline bool_t
+CO_CANtxIsConsumer(const CO_CANmodule_t* CANmodule) {
+#ifndef CO_SINGLE_THREAD
+    return __atomic_load_n(&CANmodule->txConsumerSet, __ATOMIC_ACQUIRE)
+           && pthread_equal(CANmodule->txConsumer, pthread_self());
+#else
+    (void)CANmodule;
+    return true;
+#endif
+}
+
+/* Count copies of the tx buffer, which wait in the driver. Buffer has bufferFull set, while it has any copy in a ring
+ * or in a tx queue. Copies are added by any thread and removed only by the tx consumer. If the last copy is removed,
+ * while other thread adds new one, bufferFull is set again by the one, which comes last. CANtxCount is the number of
+ * copies of all buffers. */
+static void
+CO_CANtxPendingAdd(CO_CANmodule_t* CANmodule, uint16_t index, int delta) {
+    volatile bool_t* bufferFull = &CANmodule->txArray[index].bufferFull;
+
+    if (delta > 0) {
+        (void)__atomic_add_fetch(&CANmodule->txPending[index], (uint16_t)delta, __ATOMIC_SEQ_CST);
+        __atomic_store_n(bufferFull, true, __ATOMIC_SEQ_CST);
+    } else if (__atomic_sub_fetch(&CANmodule->txPending[index], (uint16_t)-delta, __ATOMIC_SEQ_CST) == 0) {
+        __atomic_store_n(bufferFull, false, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&CANmodule->txPending[index], __ATOMIC_SEQ_CST) > 0) {
+            __atomic_store_n(bufferFull, true, __ATOMIC_SEQ_CST);
+        }
+    }
+    (void)__atomic_add_fetch(&CANmodule->CANtxCount, (uint16_t)delta, __ATOMIC_RELAXED);
+}
+
+#ifndef CO_SINGLE_THREAD
+/* Wake up the tx consumer through eventfd. Only the first call after the consumer has drained the rings writes. */
+static void
+CO_CANtxKick(CO_CANmodule_t* CANmodule) {
+    uint64_t u = 1;
+
+    if (!__atomic_exchange_n(&CANmodule->txKick, true, __ATOMIC_SEQ_CST)) {
+        if (write(CANmodule->txEventFd, &u, sizeof(u)) != sizeof(u)) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "write(tx event)");
+        }
+    }
+}
+
+/* Get ring of the calling thread, claim free one on first call. NULL, if all rings are owned by other threads. */
+static struct CO_CANtxRing*
+CO_CANtxRingOf(CO_CANmodule_t* CANmodule) {
+    pthread_t self = pthread_self();
+    uint32_t i;
+
+    for (i = 0; i < CO_DRIVER_TX_PRODUCERS; i++) {
+        struct CO_CANtxRing* ring = &CANmodule->txRings[i];
+        if (__atomic_load_n(&ring->state, __ATOMIC_ACQUIRE) == CO_CAN_TX_RING_OWNED
+            && pthread_equal(ring->owner, self)) {
+            return ring;
+        }
+    }
+    for (i = 0; i < CO_DRIVER_TX_PRODUCERS; i++) {
+        struct CO_CANtxRing* ring = &CANmodule->txRings[i];
+        uint32_t state = CO_CAN_TX_RING_FREE;
+        if (__atomic_compare_exchange_n(&ring->state, &state, CO_CAN_TX_RING_CLAIMING, false, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED)) {
+            ring->owner = self;
+            __atomic_store_n(&ring->state, CO_CAN_TX_RING_OWNED, __ATOMIC_RELEASE);
+            return ring;
+        }
+    }
+    return NULL;
+}
+
+/* Pass copy of the message to the tx consumer. Producer never waits, CO_ERROR_TX_OVERFLOW is returned, if its ring is
+ * full. */
+static CO_ReturnError_t
+CO_CANtxRingPush(CO_CANmodule_t* CANmodule, const struct CO_CANtxEntry* entry) {
+    struct CO_CANtxRing* ring = CO_CANtxRingOf(CANmodule);
+    uint32_t tail;
+
+    if (ring == NULL) {
+        log_printf(LOG_ERR, DBG_CAN_TX_FAILED, entry->buffer.ident, "no free tx ring");
+        (void)__atomic_or_fetch(&CANmodule->txErrorStatus, CO_CAN_ERRTX_OVERFLOW, __ATOMIC_RELAXED);
+        return CO_ERROR_TX_OVERFLOW;
+    }
+    tail = ring->tail;
+    if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) >= CO_DRIVER_TX_RING) {
+        log_printf(LOG_ERR, DBG_CAN_TX_FAILED, entry->buffer.ident, "tx ring full");
+        (void)__atomic_or_fetch(&CANmodule->txErrorStatus, CO_CAN_ERRTX_OVERFLOW, __ATOMIC_RELAXED);
+        return CO_ERROR_TX_OVERFLOW;
+    }
+
+    /* counted before it is visible, so the consumer never releases it first */
+    CO_CANtxPendingAdd(CANmodule, entry->index, 1);
+    ring->entries[tail % CO_DRIVER_TX_RING] = *entry;
+    __atomic_store_n(&ring->tail, tail + 1U, __ATOMIC_RELEASE);
+    CO_CANtxKick(CANmodule);
+    return CO_ERROR_NO;
+}
+#endif /* CO_SINGLE_THREAD */
+
+/* Arm or disarm epoll wakeup, when socket accepts messages again. Socket is writable, when its tx queue has free space
+ * and also after each transmitted message is released. EPOLLOUT is edge triggered on txFd, so it does not spin while
+ * socket stays writable and only the CAN interface queue is full (ENOBUFS). */
+static void
+CO_CANtxWaitSet(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, bool_t wait) {
+    struct epoll_event ev = {0};
+
+    if (interface->txWait == wait || interface->txFd < 0) {
+        return;
+    }
+    interface->txWait = wait;
+    ev.events = wait ? (EPOLLOUT | EPOLLET) : EPOLLET;
+    ev.data.ptr = &interface->txHandler;
+    if (epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_MOD, interface->txFd, &ev) < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "epoll_ctl(can tx)");
+    }
+}
+
+/* Heap order: lower CAN identifier first, lower txArray index on equal identifiers */
+static inline bool_t
+CO_CANtxQueueBefore(const struct CO_CANtxQueue* queue, uint16_t a, uint16_t b) {
+    uint32_t identA = queue->entries[a].buffer.ident & CAN_SFF_MASK;
+    uint32_t identB = queue->entries[b].buffer.ident & CAN_SFF_MASK;
+    return identA < identB || (identA == identB && a < b);
+}
+
+static inline void
+CO_CANtxQueueSet(struct CO_CANtxQueue* queue, uint16_t pos, uint16_t index) {
+    queue->heap[pos] = index;
+    queue->position[index] = pos;
+}
+
+/* Move heap entry at pos to its place, up or down */
+static void
+CO_CANtxQueueFix(struct CO_CANtxQueue* queue, uint16_t pos) {
+    uint16_t index = queue->heap[pos];
+
+    while (pos > 0) {
+        uint16_t parent = (pos - 1U) / 2U;
+        if (!CO_CANtxQueueBefore(queue, index, queue->heap[parent])) {
+            break;
+        }
+        CO_CANtxQueueSet(queue, pos, queue->heap[parent]);
+        pos = parent;
+    }
+    for (;;) {
+        uint32_t child = 2U * pos + 1U;
+        if (child >= queue->count) {
+            break;
+        }
+        if (child + 1U < queue->count && CO_CANtxQueueBefore(queue, queue->heap[child + 1U], queue->heap[child])) {
+            child++;
+        }
+        if (!CO_CANtxQueueBefore(queue, queue->heap[child], index)) {
+            break;
+        }
+        CO_CANtxQueueSet(queue, pos, queue->heap[child]);
+        pos = (uint16_t)child;
+    }
+    CO_CANtxQueueSet(queue, pos, index);
+}
+
+/* Add copy of the message to the tx queue of the interface, tx consumer only. Earlier copy of the same tx buffer is
+ * replaced. */
+static void
+CO_CANtxQueuePut(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, const struct CO_CANtxEntry* entry) {
+    struct CO_CANtxQueue* queue = interface->txQueue;
+    uint16_t pos = queue->position[entry->index];
+
+    queue->entries[entry->index] = *entry;
+    if (pos == CO_CAN_TX_NOT_QUEUED) {
+        queue->count++;
+        CO_CANtxQueueSet(queue, queue->count - 1U, entry->index);
+        CO_CANtxQueueFix(queue, queue->count - 1U);
+        CO_CANtxPendingAdd(CANmodule, entry->index, 1);
+        CO_CANtxWaitSet(CANmodule, interface, true);
+    } else {
+        CO_CANtxQueueFix(queue, pos);
+    }
+}
+
+/* Remove tx buffer from the tx queue of the interface, tx consumer only. Return false, if it was not queued. Removed
+ * copy is still counted in CO_CANtxPendingAdd(), caller releases it. */
+static bool_t
+CO_CANtxQueueTake(CO_CANinterface_t* interface, uint16_t index) {
+    struct CO_CANtxQueue* queue = interface->txQueue;
+    uint16_t pos = queue->position[index];
+
+    if (pos == CO_CAN_TX_NOT_QUEUED) {
+        return false;
+    }
+    queue->position[index] = CO_CAN_TX_NOT_QUEUED;
+    queue->count--;
+    if (pos < queue->count) {
+        CO_CANtxQueueSet(queue, pos, queue->heap[queue->count]);
+        CO_CANtxQueueFix(queue, pos);
+    }
+    return true;
+}
+
+/* Remove tx buffer from the tx queue of the interface and release its copy, tx consumer only */
+static void
+CO_CANtxQueueDrop(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, uint16_t index) {
+    if (CO_CANtxQueueTake(interface, index)) {
+        CO_CANtxPendingAdd(CANmodule, index, -1);
+    }
+}
+
+/* Get CLOCK_MONOTONIC time and offset, which converts it into CLOCK_TAI */
+static int64_t
+CO_CANtxTimeNow(int64_t* monoToTai_ns) {
+    struct timespec mono, tai;
+
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_TAI, &tai);
+    int64_t mono_ns = (int64_t)mono.tv_sec * 1000000000LL + mono.tv_nsec;
+    *monoToTai_ns = (int64_t)tai.tv_sec * 1000000000LL + tai.tv_nsec - mono_ns;
+    return mono_ns;
+}
+
+/* Get SO_TXTIME launch time in CLOCK_TAI for the message, tx consumer only. Synchronous message is launched
+ * txTimeOffset_us after SYNC message, other or late messages as soon as possible. Return 0, if interface does not use
+ * SO_TXTIME. */
+static uint64_t
+CO_CANtxTimeLaunch(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, const CO_CANtx_t* buffer) {
+    int64_t monoToTai_ns;
+    int64_t launch_ns;
+
+    if (!interface->txTime) {
+        return 0;
+    }
+    launch_ns = CO_CANtxTimeNow(&monoToTai_ns) + CO_DRIVER_TXTIME_MARGIN * 1000LL;
+    int64_t syncTime_ns = __atomic_load_n(&CANmodule->txTimeSync_ns, __ATOMIC_RELAXED);
+    if (buffer->syncFlag && syncTime_ns != 0) {
+        int64_t sync_ns = syncTime_ns + (int64_t)CANmodule->txTimeOffset_us * 1000LL;
+        if (sync_ns > launch_ns) {
+            launch_ns = sync_ns;
+        }
+    }
+    return (uint64_t)(launch_ns + monoToTai_ns);
+}
+
+/* Attach launch time to the message header, or nothing, if txtime is 0 */
+static void
+CO_CANtxTimeCmsg(struct msghdr* msghdr, char* ctrlmsg, uint64_t txtime) {
+    struct cmsghdr* cmsg;
+
+    if (txtime == 0) {
+        msghdr->msg_control = NULL;
+        msghdr->msg_controllen = 0;
+        return;
+    }
+    msghdr->msg_control = ctrlmsg;
+    msghdr->msg_controllen = CO_CAN_TXTIME_CMSG_SIZE;
+    cmsg = CMSG_FIRSTHDR(msghdr);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_TXTIME;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+    memcpy(CMSG_DATA(cmsg), &txtime, sizeof(txtime));
+}
+
+/* Bus load of tx shaper is averaged over this time. It is also the largest burst of SDO and other messages. */
+#define CO_CAN_TX_LOAD_WINDOW_NS 10000000LL
+
+/* Token buckets of one interface, see CO_CANmodule_getTxShaper(). Credits are in nanoseconds of the rate, they grow
+ * with time and each sent message costs the time, which it takes at the allowed rate. */
+struct CO_CANtxShaper {
+    int64_t last_ns;                               /* CLOCK_MONOTONIC time of last credit update */
+    int64_t classCredit_ns[CO_CAN_TX_CLASS_COUNT]; /* message is sent, if it has credit for its cost */
+    int64_t busCredit_ns;                          /* SDO and other message is sent, if not negative */
+    uint32_t deferred[CO_CAN_TX_CLASS_COUNT];
+    uint32_t loadDeferred;
+};
+
+/* Traffic class of tx message from function code of 11-bit CAN identifier, CiA301 predefined connection set */
+static CO_CANtxClass_t
+CO_CANtxClassOf(const CO_CANtx_t* buffer) {
+    uint32_t ident = buffer->ident & CAN_SFF_MASK;
+
+    if ((buffer->ident & CAN_EFF_FLAG) != 0) {
+        return CO_CAN_TX_CLASS_OTHER;
+    }
+    switch (ident >> 7) {
+        case 0x0: return CO_CAN_TX_CLASS_NMT;
+        case 0x1: return (ident == 0x080U) ? CO_CAN_TX_CLASS_NMT : CO_CAN_TX_CLASS_EMCY;
+        case 0x2: return (ident == 0x100U) ? CO_CAN_TX_CLASS_NMT : CO_CAN_TX_CLASS_OTHER;
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x6:
+        case 0x7:
+        case 0x8:
+        case 0x9:
+        case 0xA: return CO_CAN_TX_CLASS_PDO;
+        case 0xB:
+        case 0xC: return CO_CAN_TX_CLASS_SDO;
+        case 0xE: return CO_CAN_TX_CLASS_HB;
+        default: return CO_CAN_TX_CLASS_OTHER;
+    }
+}
+
+/* Number of bits on the bus for classical frame with 11-bit identifier and worst case bit stuffing. CAN FD frame is
+ * counted as classical frame with the same payload, bit rate switch is ignored. */
+static uint32_t
+CO_CANtxFrameBits(const CO_CANtx_t* buffer) {
+    uint32_t n = ((buffer->ident & CAN_RTR_FLAG) != 0) ? 0U : buffer->DLC;
+    return 8U * n + 47U + (34U + 8U * n - 1U) / 4U;
+}
+
+/* Cost of one message of the class in nanoseconds of credit */
+static inline int64_t
+CO_CANtxClassCost(const CO_CANmodule_t* CANmodule, CO_CANtxClass_t txClass) {
+    return 1000000000LL / CANmodule->txClassRate[txClass];
+}
+
+/* Messages of the class, which may be sent at once */
+static inline int64_t
+CO_CANtxClassBurst(const CO_CANmodule_t* CANmodule, CO_CANtxClass_t txClass) {
+    return (CANmodule->txClassBurst[txClass] > 0) ? (int64_t)CANmodule->txClassBurst[txClass] : 1;
+}
+
+/* CLOCK_MONOTONIC time in nanoseconds, for tx shaper and tx load */
+static int64_t
+CO_CANtxClockNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/* Add credit for time passed since last update, tx consumer only. Full buckets do not grow. */
+static void
+CO_CANtxShaperUpdate(const CO_CANmodule_t* CANmodule, struct CO_CANtxShaper* shaper, int64_t now_ns) {
+    int64_t elapsed_ns = now_ns - shaper->last_ns;
+
+    if (elapsed_ns <= 0) {
+        return;
+    }
+    shaper->last_ns = now_ns;
+    for (int c = 0; c < CO_CAN_TX_CLASS_COUNT; c++) {
+        if (CANmodule->txClassRate[c] > 0) {
+            int64_t cap = CO_CANtxClassBurst(CANmodule, c) * CO_CANtxClassCost(CANmodule, c);
+            shaper->classCredit_ns[c] += elapsed_ns;
+            if (shaper->classCredit_ns[c] > cap) {
+                shaper->classCredit_ns[c] = cap;
+            }
+        }
+    }
+    shaper->busCredit_ns += elapsed_ns;
+    if (shaper->busCredit_ns > CO_CAN_TX_LOAD_WINDOW_NS) {
+        shaper->busCredit_ns = CO_CAN_TX_LOAD_WINDOW_NS;
+    }
+}
+
+/* Verify, if message may be sent now, tx consumer only. If not, it is counted as deferred, if counted is false, and
+ * next_ns is set to CLOCK_MONOTONIC time, when message will have credit. */
+static bool_t
+CO_CANtxShaperAllow(const CO_CANmodule_t* CANmodule, struct CO_CANtxShaper* shaper, const CO_CANtx_t* buffer,
+                    bool_t counted, int64_t* next_ns) {
+    CO_CANtxClass_t txClass = CO_CANtxClassOf(buffer);
+    int64_t wait_ns = 0;
+    bool_t load;
+
+    CO_CANtxShaperUpdate(CANmodule, shaper, CO_CANtxClockNow());
+    if (CANmodule->txClassRate[txClass] > 0) {
+        wait_ns = CO_CANtxClassCost(CANmodule, txClass) - shaper->classCredit_ns[txClass];
+    }
+    /* bus load limit holds back only low priority bulk traffic, both credits grow at the same rate */
+    load = CANmodule->txLoadRate > 0 && shaper->busCredit_ns < 0
+           && (txClass == CO_CAN_TX_CLASS_SDO || txClass == CO_CAN_TX_CLASS_OTHER);
+    if (wait_ns <= 0 && !load) {
+        return true;
+    }
+    if (load && -shaper->busCredit_ns > wait_ns) {
+        wait_ns = -shaper->busCredit_ns;
+    }
+    *next_ns = shaper->last_ns + wait_ns;
+    if (!counted) {
+        __atomic_add_fetch(&shaper->deferred[txClass], 1U, __ATOMIC_RELAXED);
+        if (load) {
+            __atomic_add_fetch(&shaper->loadDeferred, 1U, __ATOMIC_RELAXED);
+        }
+    }
+    return false;
+}
+
+/* Take credit for sent message, tx consumer only. All messages load the bus. Negative count returns credit of
+ * message, which was charged, but dropped before it was written. */
+static void
+CO_CANtxShaperCharge(const CO_CANmodule_t* CANmodule, struct CO_CANtxShaper* shaper, const CO_CANtx_t* buffer,
+                     int64_t count) {
+    CO_CANtxClass_t txClass = CO_CANtxClassOf(buffer);
+
+    if (CANmodule->txClassRate[txClass] > 0) {
+        int64_t cap = CO_CANtxClassBurst(CANmodule, txClass) * CO_CANtxClassCost(CANmodule, txClass);
+        shaper->classCredit_ns[txClass] -= count * CO_CANtxClassCost(CANmodule, txClass);
+        if (shaper->classCredit_ns[txClass] > cap) {
+            shaper->classCredit_ns[txClass] = cap;
+        }
+    }
+    if (CANmodule->txLoadRate > 0) {
+        shaper->busCredit_ns -= count * (int64_t)CO_CANtxFrameBits(buffer) * 1000000000LL / CANmodule->txLoadRate;
+        if (shaper->busCredit_ns < -CO_CAN_TX_LOAD_WINDOW_NS) {
+            shaper->busCredit_ns = -CO_CAN_TX_LOAD_WINDOW_NS;
+        } else if (shaper->busCredit_ns > CO_CAN_TX_LOAD_WINDOW_NS) {
+            shaper->busCredit_ns = CO_CAN_TX_LOAD_WINDOW_NS;
+        }
+    }
+}
+
 #if CO_DRIVER_MULTI_INTERFACE > 0
 
 static const uint32_t CO_INVALID_COB_ID = 0xffffffff;
@@ -81,8 +663,382 @@ CO_CANgetIndexFromIdent(uint32_t* lookup, uint32_t ident) {
     return lookup[ident];
 }
 
+/* Tx load of interface is measured in windows of this length, see CO_CANtxLoad() */
+#define CO_CAN_TX_LOAD_ROUTE_WINDOW_NS 100000000LL
+
+/* Bits on the bus for message, which waits in tx queue: 8 data bytes */
+#define CO_CAN_TX_LOAD_QUEUED_BITS 135U
+
+/* All interfaces, see CO_CANtxRoute() */
+#define CO_CAN_TX_ROUTE_ALL 0xFFFFFFFFU
+
+/* Routing table, see CO_CANmodule_setTxRoutes() */
+struct CO_CANtxRoutes {
+    uint8_t lookup[CO_CAN_MSG_SFF_MAX_COB_ID]; /* index + 1 in routes for each 11-bit identifier, 0 if none */
+    uint16_t count;
+    CO_CANtxRoute_t routes[];
+};
+
+static inline bool_t
+CO_CANtxRouteHas(uint32_t route, uint32_t i) {
+    return route == CO_CAN_TX_ROUTE_ALL || (i < 32U && (route & (1UL << i)) != 0U);
+}
+
+/* Move window of tx load measurement to current time */
+static void
+CO_CANtxLoadRotate(CO_CANinterface_t* interface, int64_t now_ns) {
+    int64_t elapsed_ns = now_ns - interface->txLoadWindow_ns;
+
+    if (elapsed_ns >= 2 * CO_CAN_TX_LOAD_ROUTE_WINDOW_NS) {
+        interface->txLoadBits[0] = 0;
+        interface->txLoadBits[1] = 0;
+        interface->txLoadWindow_ns = now_ns;
+    } else if (elapsed_ns >= CO_CAN_TX_LOAD_ROUTE_WINDOW_NS) {
+        interface->txLoadBits[1] = interface->txLoadBits[0];
+        interface->txLoadBits[0] = 0;
+        interface->txLoadWindow_ns += CO_CAN_TX_LOAD_ROUTE_WINDOW_NS;
+    }
+}
+
+/* Bits sent within last window, previous window is weighted by its overlap. Messages waiting in tx queue are added, so
+ * congested interface is not selected. Tx consumer only. */
+static uint64_t
+CO_CANtxLoad(CO_CANinterface_t* interface, int64_t now_ns) {
+    uint64_t load;
+    int64_t overlap_ns;
+
+    CO_CANtxLoadRotate(interface, now_ns);
+    overlap_ns = CO_CAN_TX_LOAD_ROUTE_WINDOW_NS - (now_ns - interface->txLoadWindow_ns);
+    load = interface->txLoadBits[0]
+           + (uint64_t)interface->txLoadBits[1] * (uint64_t)overlap_ns / CO_CAN_TX_LOAD_ROUTE_WINDOW_NS;
+    load += (uint64_t)interface->txQueue->count * CO_CAN_TX_LOAD_QUEUED_BITS;
+#if CO_DRIVER_TX_BATCH > 1
+    if (interface->txBatch != NULL) {
+        load += (uint64_t)interface->txBatch->count * CO_CAN_TX_LOAD_QUEUED_BITS;
+    }
+#endif
+    return load;
+}
+
+/* Get set of interfaces for message from routing table, bit n is CANinterfaces[n], tx consumer only */
+static uint32_t
+CO_CANtxRoute(CO_CANmodule_t* CANmodule, const CO_CANtx_t* buffer) {
+    const struct CO_CANtxRoutes* routes = CANmodule->txRoutes;
+    const CO_CANtxRoute_t* route;
+    int64_t now_ns;
+    int best = -1;
+    uint64_t bestLoad = 0;
+    bool_t bestActive = false;
+
+    if (routes == NULL || (buffer->ident & CAN_EFF_FLAG) != 0 || routes->lookup[buffer->ident & CAN_SFF_MASK] == 0) {
+        return CO_CAN_TX_ROUTE_ALL;
+    }
+    route = &routes->routes[routes->lookup[buffer->ident & CAN_SFF_MASK] - 1U];
+    if (!route->leastLoaded) {
+        return route->interfaces;
+    }
+
+    /* interface, which is not in listen only mode, has precedence */
+    now_ns = CO_CANtxClockNow();
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount && i < 32U; i++) {
+        CO_CANinterface_t* interface = &CANmodule->CANinterfaces[i];
+        bool_t active = true;
+        uint64_t load;
+
+        if ((route->interfaces & (1UL << i)) == 0U) {
+            continue;
+        }
+#if CO_DRIVER_ERROR_REPORTING > 0
+        active = !interface->errorhandler.listenOnly;
+#endif
+        load = CO_CANtxLoad(interface, now_ns);
+        if (best < 0 || (active && !bestActive) || (active == bestActive && load < bestLoad)) {
+            best = (int)i;
+            bestLoad = load;
+            bestActive = active;
+        }
+    }
+    return (best < 0) ? 0U : (1UL << best);
+}
+
 #endif /* CO_DRIVER_MULTI_INTERFACE */
 
+/* Mask bits, which must be set in rx buffer, so it can be used in rxIdentToIndex lookup table */
+#define CO_CAN_RX_EXACT_MASK (CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG)
+
+/* Rx buffer matches only one standard non-rtr identifier, so it can be found with lookup table */
+static inline bool_t
+CO_CANrxIsExact(const CO_CANrx_t* buffer) {
+    return ((buffer->mask & CO_CAN_RX_EXACT_MASK) == CO_CAN_RX_EXACT_MASK) && ((buffer->ident & ~CAN_SFF_MASK) == 0);
+}
+
+/* Update rx lookup structures after rxArray[index] has changed. Entry had identifier identOld before the change. */
+static void
+CO_CANrxLookupUpdate(CO_CANmodule_t* CANmodule, uint16_t index, uint32_t identOld, bool_t exactOld) {
+    const CO_CANrx_t* buffer = &CANmodule->rxArray[index];
+    uint16_t* lookup = CANmodule->rxIdentToIndex;
+    uint16_t i;
+
+    /* remove old entry, another buffer with the same identifier may take its place */
+    if (exactOld && lookup[identOld] == index) {
+        uint16_t indexNew = CO_CAN_RX_INDEX_NONE;
+        for (i = 0; i < CANmodule->rxSize; i++) {
+            if (CO_CANrxIsExact(&CANmodule->rxArray[i]) && CANmodule->rxArray[i].ident == identOld) {
+                indexNew = i;
+                break;
+            }
+        }
+        lookup[identOld] = indexNew;
+    }
+
+    /* add new entry, lower index has precedence */
+    if (CO_CANrxIsExact(buffer)) {
+        if (lookup[buffer->ident] == CO_CAN_RX_INDEX_NONE || lookup[buffer->ident] > index) {
+            lookup[buffer->ident] = index;
+        }
+    }
+
+    /* rebuild list of masked entries, if this entry is or was part of it */
+    if (!exactOld || !CO_CANrxIsExact(buffer)) {
+        uint16_t count = 0;
+        for (i = 0; i < CANmodule->rxSize; i++) {
+            if (!CO_CANrxIsExact(&CANmodule->rxArray[i])) {
+                CANmodule->rxMasked[count++] = i;
+            }
+        }
+        CANmodule->rxMaskedCount = count;
+    }
+}
+
+/* Get index of rx buffer, which matches CAN identifier, or CO_CAN_RX_INDEX_NONE. Result is the same as from linear
+ * search through rxArray, which would take the first match. */
+static uint16_t
+CO_CANrxLookup(CO_CANmodule_t* CANmodule, uint32_t ident) {
+    uint16_t index = CO_CAN_RX_INDEX_NONE;
+
+    if ((ident & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)) == 0) {
+        index = CANmodule->rxIdentToIndex[ident & CAN_SFF_MASK];
+        if (index != CO_CAN_RX_INDEX_NONE) {
+            const CO_CANrx_t* buffer = &CANmodule->rxArray[index];
+            if (((ident ^ buffer->ident) & buffer->mask) != 0U) {
+                index = CO_CAN_RX_INDEX_NONE;
+            }
+        }
+    }
+
+    /* Only few entries should be here. They can precede exact entry in rxArray. */
+    for (uint16_t i = 0; i < CANmodule->rxMaskedCount && CANmodule->rxMasked[i] < index; i++) {
+        const CO_CANrx_t* buffer = &CANmodule->rxArray[CANmodule->rxMasked[i]];
+        if (((ident ^ buffer->ident) & buffer->mask) == 0U) {
+            index = CANmodule->rxMasked[i];
+            break;
+        }
+    }
+
+    return index;
+}
+
+/* Mask bits, which must be set in 29-bit rx buffer, so it can be used in rxEffSorted */
+#define CO_CAN_RX_EFF_EXACT_MASK (CAN_EFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG)
+
+/* Rebuild lookup lists for rxEffArray. Unused entries have CAN_EFF_FLAG cleared. */
+static void
+CO_CANrxEffLookupUpdate(CO_CANmodule_t* CANmodule) {
+    const CO_CANrx_t* rxEff = CANmodule->rxEffArray;
+    uint16_t* sorted = CANmodule->rxEffSorted;
+    uint16_t sortedCount = 0;
+    uint16_t maskedCount = 0;
+
+    for (uint16_t i = 0; i < CANmodule->rxEffSize; i++) {
+        if ((rxEff[i].ident & CAN_EFF_FLAG) == 0) {
+            continue;
+        }
+        if ((rxEff[i].mask & CO_CAN_RX_EFF_EXACT_MASK) == CO_CAN_RX_EFF_EXACT_MASK) {
+            /* insertion sort, equal identifiers keep ascending index order */
+            uint16_t j = sortedCount++;
+            while (j > 0 && rxEff[sorted[j - 1]].ident > rxEff[i].ident) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = i;
+        } else {
+            CANmodule->rxEffMasked[maskedCount++] = i;
+        }
+    }
+    CANmodule->rxEffSortedCount = sortedCount;
+    CANmodule->rxEffMaskedCount = maskedCount;
+}
+
+/* Get index of 29-bit rx buffer, which matches CAN identifier, or CO_CAN_RX_INDEX_NONE */
+static uint16_t
+CO_CANrxEffLookup(CO_CANmodule_t* CANmodule, uint32_t ident) {
+    const CO_CANrx_t* rxEff = CANmodule->rxEffArray;
+    const uint16_t* sorted = CANmodule->rxEffSorted;
+    uint32_t key = ident & CO_CAN_RX_EFF_EXACT_MASK;
+    uint16_t low = 0;
+    uint16_t high = CANmodule->rxEffSortedCount;
+
+    /* binary search for the first entry not less than key */
+    while (low < high) {
+        uint16_t mid = low + (high - low) / 2;
+        if (rxEff[sorted[mid]].ident < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < CANmodule->rxEffSortedCount && rxEff[sorted[low]].ident == key) {
+        return sorted[low];
+    }
+
+    for (uint16_t i = 0; i < CANmodule->rxEffMaskedCount; i++) {
+        const CO_CANrx_t* buffer = &rxEff[CANmodule->rxEffMasked[i]];
+        if (((ident ^ buffer->ident) & buffer->mask) == 0U) {
+            return CANmodule->rxEffMasked[i];
+        }
+    }
+
+    return CO_CAN_RX_INDEX_NONE;
+}
+
+/* Return value of BPF program, which accepts whole message */
+#define CO_CAN_BPF_ACCEPT 0xFFFFFFFFU
+
+/* BPF program under construction */
+typedef struct {
+    struct sock_filter* insns;
+    int len; /* number of instructions, counted also beyond max */
+    int max;
+} CO_CANbpf_t;
+
+typedef struct {
+    uint32_t lo;
+    uint32_t hi;
+} CO_CANbpfRange_t;
+
+static void
+CO_CANbpfEmit(CO_CANbpf_t* bpf, uint16_t code, uint32_t k, uint8_t jt, uint8_t jf) {
+    if (bpf->len < bpf->max) {
+        struct sock_filter insn = BPF_JUMP(code, k, jt, jf);
+        bpf->insns[bpf->len] = insn;
+    }
+    bpf->len++;
+}
+
+static int
+CO_CANbpfCompareIdent(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* Number of instructions, generated by CO_CANbpfTree() for ranges[l..r] */
+static int
+CO_CANbpfTreeSize(const CO_CANbpfRange_t* ranges, int l, int r) {
+    if (l == r) {
+        return (ranges[l].lo == ranges[l].hi) ? 3 : 4;
+    }
+    int mid = (l + r + 1) / 2;
+    int right = CO_CANbpfTreeSize(ranges, mid, r);
+    return 1 + (right > 255 ? 1 : 0) + right + CO_CANbpfTreeSize(ranges, l, mid - 1);
+}
+
+/* Binary search over sorted, disjoint ranges of identifiers in A. Each leaf has own return instructions, so only inner
+ * nodes jump forward, over the right subtree to the left one. Jump over more than 255 instructions uses trampoline. */
+static void
+CO_CANbpfTree(CO_CANbpf_t* bpf, const CO_CANbpfRange_t* ranges, int l, int r) {
+    if (l == r) {
+        if (ranges[l].lo == ranges[l].hi) {
+            CO_CANbpfEmit(bpf, BPF_JMP | BPF_JEQ | BPF_K, ranges[l].lo, 0, 1);
+        } else {
+            CO_CANbpfEmit(bpf, BPF_JMP | BPF_JGE | BPF_K, ranges[l].lo, 0, 2);
+            CO_CANbpfEmit(bpf, BPF_JMP | BPF_JGT | BPF_K, ranges[l].hi, 1, 0);
+        }
+        CO_CANbpfEmit(bpf, BPF_RET | BPF_K, CO_CAN_BPF_ACCEPT, 0, 0);
+        CO_CANbpfEmit(bpf, BPF_RET | BPF_K, 0, 0, 0);
+        return;
+    }
+
+    int mid = (l + r + 1) / 2;
+    int right = CO_CANbpfTreeSize(ranges, mid, r);
+    if (right > 255) {
+        CO_CANbpfEmit(bpf, BPF_JMP | BPF_JGE | BPF_K, ranges[mid].lo, 1, 0);
+        CO_CANbpfEmit(bpf, BPF_JMP | BPF_JA, (uint32_t)right, 0, 0);
+    } else {
+        CO_CANbpfEmit(bpf, BPF_JMP | BPF_JGE | BPF_K, ranges[mid].lo, 0, (uint8_t)right);
+    }
+    CO_CANbpfTree(bpf, ranges, mid, r);
+    CO_CANbpfTree(bpf, ranges, l, mid - 1);
+}
+
+/* Compile socketCAN filter list into classic BPF program. Filters with full mask are merged into ranges of identifiers
+ * and searched with binary tree, filters with partial mask are checked linearly before. Error messages are always
+ * accepted, they are filtered by CAN_RAW_ERR_FILTER. Return number of instructions or -1, if program is too long. */
+static int
+CO_CANbpfCompile(const struct can_filter* filters, int count, struct sock_filter* insns, int max) {
+    CO_CANbpf_t bpf = {.insns = insns, .len = 0, .max = max};
+    uint32_t idents[count > 0 ? count : 1];
+    CO_CANbpfRange_t ranges[count > 0 ? count : 1];
+    int identsCount = 0;
+    int rangesCount = 0;
+
+    /* A = X = can_id. It is in host byte order in struct can_frame, BPF_LD | BPF_W loads network byte order. */
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    CO_CANbpfEmit(&bpf, BPF_LD | BPF_B | BPF_ABS, 0, 0, 0);
+    for (uint32_t byte = 1; byte < 4; byte++) {
+        CO_CANbpfEmit(&bpf, BPF_ST, 0, 0, 0);
+        CO_CANbpfEmit(&bpf, BPF_LD | BPF_B | BPF_ABS, byte, 0, 0);
+        CO_CANbpfEmit(&bpf, BPF_ALU | BPF_LSH | BPF_K, byte * 8, 0, 0);
+        CO_CANbpfEmit(&bpf, BPF_MISC | BPF_TAX, 0, 0, 0);
+        CO_CANbpfEmit(&bpf, BPF_LD | BPF_MEM, 0, 0, 0);
+        CO_CANbpfEmit(&bpf, BPF_ALU | BPF_OR | BPF_X, 0, 0, 0);
+    }
+#else
+    CO_CANbpfEmit(&bpf, BPF_LD | BPF_W | BPF_ABS, 0, 0, 0);
+#endif
+    CO_CANbpfEmit(&bpf, BPF_MISC | BPF_TAX, 0, 0, 0);
+
+    /* error messages */
+    CO_CANbpfEmit(&bpf, BPF_JMP | BPF_JSET | BPF_K, CAN_ERR_FLAG, 0, 1);
+    CO_CANbpfEmit(&bpf, BPF_RET | BPF_K, CO_CAN_BPF_ACCEPT, 0, 0);
+
+    for (int i = 0; i < count; i++) {
+        uint32_t id = filters[i].can_id;
+        uint32_t mask = filters[i].can_mask;
+        uint32_t fullMask = CAN_EFF_FLAG | CAN_RTR_FLAG | (((id & CAN_EFF_FLAG) != 0) ? CAN_EFF_MASK : CAN_SFF_MASK);
+
+        if ((mask & fullMask) == fullMask) {
+            idents[identsCount++] = id & fullMask;
+        } else {
+            /* filter with partial mask */
+            CO_CANbpfEmit(&bpf, BPF_MISC | BPF_TXA, 0, 0, 0);
+            CO_CANbpfEmit(&bpf, BPF_ALU | BPF_AND | BPF_K, mask, 0, 0);
+            CO_CANbpfEmit(&bpf, BPF_JMP | BPF_JEQ | BPF_K, id & mask, 0, 1);
+            CO_CANbpfEmit(&bpf, BPF_RET | BPF_K, CO_CAN_BPF_ACCEPT, 0, 0);
+        }
+    }
+
+    /* sort identifiers and merge them into ranges */
+    qsort(idents, identsCount, sizeof(idents[0]), CO_CANbpfCompareIdent);
+    for (int i = 0; i < identsCount; i++) {
+        if (rangesCount > 0 && idents[i] <= ranges[rangesCount - 1].hi + 1) {
+            ranges[rangesCount - 1].hi = idents[i];
+        } else {
+            ranges[rangesCount].lo = idents[i];
+            ranges[rangesCount].hi = idents[i];
+            rangesCount++;
+        }
+    }
+
+    if (rangesCount > 0) {
+        CO_CANbpfEmit(&bpf, BPF_MISC | BPF_TXA, 0, 0, 0);
+        CO_CANbpfTree(&bpf, ranges, 0, rangesCount - 1);
+    } else {
+        CO_CANbpfEmit(&bpf, BPF_RET | BPF_K, 0, 0, 0);
+    }
+
+    return (bpf.len <= max) ? bpf.len : -1;
+}
+
 /* Disable socketCAN rx */
 static CO_ReturnError_t
 disableRx(CO_CANmodule_t* CANmodule) {
@@ -103,6 +1059,51 @@ disableRx(CO_CANmodule_t* CANmodule) {
     return retval;
 }
 
+/* Time, after which failed install of rx filters is repeated, see CO_CANmodule_rxFiltersNext_us() */
+#define CO_CAN_RX_FILTER_RETRY_US 100000U
+
+/* Compile rx filters into BPF program and attach it to all sockets, CAN_RAW_FILTER then passes all messages. If BPF
+ * can not be used, it is detached and error is returned, so caller can fall back to CAN_RAW_FILTER. */
+static CO_ReturnError_t
+setRxFiltersBpf(CO_CANmodule_t* CANmodule, const struct can_filter* filters, int count) {
+    struct can_filter passAll = {.can_id = 0, .can_mask = 0};
+    struct sock_fprog fprog;
+    CO_ReturnError_t retval = CO_ERROR_NO;
+    uint32_t i;
+    int len;
+
+    fprog.filter = malloc(BPF_MAXINSNS * sizeof(struct sock_filter));
+    if (fprog.filter == NULL) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    len = CO_CANbpfCompile(filters, count, fprog.filter, BPF_MAXINSNS);
+    if (len < 0) {
+        log_printf(LOG_WARNING, CAN_BPF_TOO_LONG, count);
+        retval = CO_ERROR_OUT_OF_MEMORY;
+    }
+    fprog.len = (unsigned short)len;
+
+    for (i = 0; i < CANmodule->CANinterfaceCount && retval == CO_ERROR_NO; i++) {
+        CO_CANinterface_t* interface = &CANmodule->CANinterfaces[i];
+        if (setsockopt(interface->fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0
+            || setsockopt(interface->fd, SOL_CAN_RAW, CAN_RAW_FILTER, &passAll, sizeof(passAll)) < 0) {
+            log_printf(LOG_ERR, CAN_FILTER_FAILED, interface->ifName);
+            log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt(bpf)");
+            retval = CO_ERROR_SYSCALL;
+        }
+    }
+    free(fprog.filter);
+
+    if (retval != CO_ERROR_NO) {
+        int dummy = 0;
+        for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
+            (void)setsockopt(CANmodule->CANinterfaces[i].fd, SOL_SOCKET, SO_DETACH_FILTER, &dummy, sizeof(dummy));
+        }
+    }
+    return retval;
+}
+
 /* Set up or update socketCAN rx filters */
 static CO_ReturnError_t
 setRxFilters(CO_CANmodule_t* CANmodule) {
@@ -110,7 +1111,9 @@ setRxFilters(CO_CANmodule_t* CANmodule) {
     int count;
     CO_ReturnError_t retval;
 
-    struct can_filter rxFiltersCpy[CANmodule->rxSize];
+    struct can_filter rxFiltersCpy[CANmodule->rxSize + CANmodule->rxEffSize];
+
+    CANmodule->rxFilterInstalls++;
 
     count = 0;
     /* remove unused entries ( id == 0 and mask == 0 ) as they would act as "pass all" filter */
@@ -122,23 +1125,38 @@ setRxFilters(CO_CANmodule_t* CANmodule) {
             count++;
         }
     }
+    /* configured 29-bit entries */
+    for (i = 0; i < CANmodule->rxEffSize; i++) {
+        if ((CANmodule->rxEffArray[i].ident & CAN_EFF_FLAG) != 0) {
+            rxFiltersCpy[count].can_id = CANmodule->rxEffArray[i].ident;
+            rxFiltersCpy[count].can_mask = CANmodule->rxEffArray[i].mask;
+            count++;
+        }
+    }
 
     if (count == 0) {
         /* No filter is set, disable RX */
-        return disableRx(CANmodule);
-    }
-
-    retval = CO_ERROR_NO;
-    for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
-        int ret = setsockopt(CANmodule->CANinterfaces[i].fd, SOL_CAN_RAW, CAN_RAW_FILTER, rxFiltersCpy,
-                             sizeof(struct can_filter) * count);
-        if (ret < 0) {
-            log_printf(LOG_ERR, CAN_FILTER_FAILED, CANmodule->CANinterfaces[i].ifName);
-            log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt()");
-            retval = CO_ERROR_SYSCALL;
+        retval = disableRx(CANmodule);
+    } else if (CANmodule->rxFilterBpf && setRxFiltersBpf(CANmodule, rxFiltersCpy, count) == CO_ERROR_NO) {
+        retval = CO_ERROR_NO;
+    } else {
+        retval = CO_ERROR_NO;
+        for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
+            int ret = setsockopt(CANmodule->CANinterfaces[i].fd, SOL_CAN_RAW, CAN_RAW_FILTER, rxFiltersCpy,
+                                 sizeof(struct can_filter) * count);
+            if (ret < 0) {
+                log_printf(LOG_ERR, CAN_FILTER_FAILED, CANmodule->CANinterfaces[i].ifName);
+                log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt()");
+                retval = CO_ERROR_SYSCALL;
+            }
         }
     }
 
+    /* keep filters dirty on error, so they are installed again on next CO_CANmodule_process() */
+    CANmodule->rxFilterFailed = retval != CO_ERROR_NO;
+    if (retval == CO_ERROR_NO) {
+        CANmodule->rxFilterDirty = false;
+    }
     return retval;
 }
 
@@ -165,9 +1183,8 @@ CO_CANsetNormalMode(CO_CANmodule_t* CANmodule) {
 CO_ReturnError_t
 CO_CANmodule_init(CO_CANmodule_t* CANmodule, void* CANptr, CO_CANrx_t rxArray[], uint16_t rxSize, CO_CANtx_t txArray[],
                   uint16_t txSize, uint16_t CANbitRate) {
-    int32_t ret;
+    CO_ReturnError_t ret = CO_ERROR_NO;
     uint16_t i;
-    (void)CANbitRate;
 
     /* verify arguments */
     if (CANmodule == NULL || CANptr == NULL || rxArray == NULL || txArray == NULL) {
@@ -187,12 +1204,43 @@ CO_CANmodule_init(CO_CANmodule_t* CANmodule, void* CANptr, CO_CANrx_t rxArray[],
     CANmodule->CANerrorStatus = 0;
     CANmodule->CANnormal = false;
     CANmodule->CANtxCount = 0;
+    CANmodule->txSyncPurged = 0;
+    CANmodule->timestamp = CANptrReal->timestamp;
+    CANmodule->rxBufferSize = CANptrReal->rxBufferSize;
+    CANmodule->rxBufferSizeMax = CANptrReal->rxBufferSizeMax;
+    CANmodule->rxBusyPoll_us = CANptrReal->rxBusyPoll_us;
+    CANmodule->rxDropCount = 0;
+    CANmodule->rxDropThreshold = CANptrReal->rxDropThreshold;
+    CANmodule->rxFilterBpf = CANptrReal->rxFilterBpf;
+    CANmodule->rxFilterDirty = false;
+    CANmodule->rxFilterFailed = false;
+    CANmodule->rxFilterHold = 0;
+    CANmodule->rxFilterInstalls = 0;
+    CANmodule->rxEffArray = CANptrReal->rxEffArray;
+    CANmodule->rxEffSize = (CANptrReal->rxEffArray != NULL) ? CANptrReal->rxEffSize : 0;
+    CANmodule->rxEffSortedCount = 0;
+    CANmodule->rxEffMaskedCount = 0;
+
+    /* Everything allocated below is released by CO_CANmodule_disable(), also if initialization fails in between */
+    CANmodule->rxFilter = NULL;
+    CANmodule->rxMasked = NULL;
+    CANmodule->rxEffSorted = NULL;
+    CANmodule->rxEffMasked = NULL;
+#if CO_DRIVER_RX_BATCH > 1
+    CANmodule->rxBatch = NULL;
+#endif
+    CANmodule->txStamps = NULL;
+    CANmodule->txPending = NULL;
+#ifndef CO_SINGLE_THREAD
+    CANmodule->txRings = NULL;
+    CANmodule->txEventFd = -1;
+#endif
 
 #if CO_DRIVER_MULTI_INTERFACE > 0
     for (i = 0; i < CO_CAN_MSG_SFF_MAX_COB_ID; i++) {
-        CANmodule->rxIdentToIndex[i] = CO_INVALID_COB_ID;
         CANmodule->txIdentToIndex[i] = CO_INVALID_COB_ID;
     }
+    CANmodule->txRoutes = NULL;
 #endif
 
     /* initialize socketCAN filters. CAN module filters will be configured with
@@ -200,8 +1248,103 @@ CO_CANmodule_init(CO_CANmodule_t* CANmodule, void* CANptr, CO_CANrx_t rxArray[],
     CANmodule->rxFilter = calloc(CANmodule->rxSize, sizeof(struct can_filter));
     if (CANmodule->rxFilter == NULL) {
         log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+        CO_CANmodule_disable(CANmodule);
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+
+#if CO_DRIVER_RX_BATCH > 1
+    /* prepare buffers for recvmmsg(), they are reused for each read */
+    CANmodule->rxBatch = calloc(1, sizeof(struct CO_CANrxBatch));
+    if (CANmodule->rxBatch == NULL) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+        CO_CANmodule_disable(CANmodule);
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    for (i = 0U; i < CO_DRIVER_RX_BATCH; i++) {
+        struct CO_CANrxBatch* batch = CANmodule->rxBatch;
+
+        batch->iov[i].iov_base = &batch->frames[i];
+        batch->iov[i].iov_len = sizeof(batch->frames[i]);
+        batch->msgs[i].msg_hdr.msg_iov = &batch->iov[i];
+        batch->msgs[i].msg_hdr.msg_iovlen = 1;
+        batch->msgs[i].msg_hdr.msg_control = batch->ctrlmsg[i];
+    }
+#endif
+
+    CANmodule->txTimeOffset_us = CANptrReal->txTimeOffset_us;
+    CANmodule->txTimeSyncIdent = (CANptrReal->txTimeSyncIdent != 0) ? CANptrReal->txTimeSyncIdent : 0x080U;
+    CANmodule->txTimeSync_ns = 0;
+
+    /* tx shaper, CANbitRate is in kbit/s */
+    for (i = 0U; i < CO_CAN_TX_CLASS_COUNT; i++) {
+        CANmodule->txClassRate[i] = CANptrReal->txClassRate[i];
+        CANmodule->txClassBurst[i] = CANptrReal->txClassBurst[i];
+    }
+    {
+        uint64_t bitRate = (CANptrReal->txBitRate != 0) ? CANptrReal->txBitRate : (uint64_t)CANbitRate * 1000U;
+        CANmodule->txLoadRate = (uint32_t)(bitRate * CANptrReal->txLoadMax / 100U);
+    }
+    CANmodule->txShaperNext_ns = 0;
+
+    /* tx latency statistics, one entry per tx buffer is enough for usual configuration */
+    CANmodule->txLatency = CANptrReal->txLatency;
+    if (CANmodule->txLatency) {
+        struct CO_CANtxStamps* stamps = calloc(1, sizeof(*stamps) + txSize * sizeof(stamps->latency[0]));
+        if (stamps == NULL) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+            CO_CANmodule_disable(CANmodule);
+            return CO_ERROR_OUT_OF_MEMORY;
+        }
+        CANmodule->txStamps = stamps;
+        stamps->size = txSize;
+        for (i = 0; i < CO_CAN_MSG_SFF_MAX_COB_ID; i++) {
+            stamps->slot[i] = CO_CAN_TX_STAMP_NONE;
+        }
+    }
+
+    /* copies of each tx buffer, which wait in the driver, see CO_CANtxPendingAdd() */
+    CANmodule->txPending = calloc(txSize + 1U, sizeof(*CANmodule->txPending));
+    if (CANmodule->txPending == NULL) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+        CO_CANmodule_disable(CANmodule);
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    CANmodule->txErrorStatus = 0;
+
+#ifndef CO_SINGLE_THREAD
+    /* Tx queues are allocated for each interface by CO_CANmodule_addInterface(). Other threads pass messages to the tx
+     * consumer through rings and wake it up with eventfd, see CO_CANmodule_txConsumer(). */
+    CANmodule->txConsumerSet = false;
+    CANmodule->txKick = false;
+    CANmodule->txRequest = 0;
+    CANmodule->txRings = calloc(CO_DRIVER_TX_PRODUCERS, sizeof(*CANmodule->txRings));
+    if (CANmodule->txRings == NULL) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+        CO_CANmodule_disable(CANmodule);
         return CO_ERROR_OUT_OF_MEMORY;
     }
+    CANmodule->txEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (CANmodule->txEventFd < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "eventfd(txEventFd)");
+        CO_CANmodule_disable(CANmodule);
+        return CO_ERROR_SYSCALL;
+    }
+    CANmodule->txEventHandler.fd = CANmodule->txEventFd;
+    CANmodule->txEventHandler.type = CO_EPOLL_HANDLER_CAN_TX;
+    CANmodule->txEventHandler.object = CANmodule;
+    {
+        struct epoll_event ev = {0};
+
+        ev.events = EPOLLIN;
+        ev.data.ptr = &CANmodule->txEventHandler;
+        if (epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_ADD, CANmodule->txEventFd, &ev) < 0) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "epoll_ctl(txEventFd)");
+            CO_CANmodule_disable(CANmodule);
+            return CO_ERROR_SYSCALL;
+        }
+    }
+    pthread_mutex_init(&CANmodule->txStampMutex, NULL);
+#endif
 
     for (i = 0U; i < rxSize; i++) {
         rxArray[i].ident = 0U;
@@ -212,32 +1355,274 @@ CO_CANmodule_init(CO_CANmodule_t* CANmodule, void* CANptr, CO_CANrx_t rxArray[],
         rxArray[i].timestamp.tv_sec = 0;
         rxArray[i].timestamp.tv_nsec = 0;
     }
+    for (i = 0U; i < txSize; i++) {
+        txArray[i].bufferFull = false;
+    }
+
+    /* initialize rx lookup, all buffers are now exact match for identifier 0 */
+    CANmodule->rxMasked = calloc(CANmodule->rxSize, sizeof(*CANmodule->rxMasked));
+    if (CANmodule->rxMasked == NULL) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+        CO_CANmodule_disable(CANmodule);
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    CANmodule->rxMaskedCount = 0;
+    for (i = 0; i < CO_CAN_MSG_SFF_MAX_COB_ID; i++) {
+        CANmodule->rxIdentToIndex[i] = CO_CAN_RX_INDEX_NONE;
+    }
+    if (rxSize > 0) {
+        CANmodule->rxIdentToIndex[0] = 0;
+    }
+
+    /* 29-bit rx buffers are all unused */
+    CANmodule->rxEffSorted = calloc(CANmodule->rxEffSize + 1U, sizeof(*CANmodule->rxEffSorted));
+    CANmodule->rxEffMasked = calloc(CANmodule->rxEffSize + 1U, sizeof(*CANmodule->rxEffMasked));
+    if (CANmodule->rxEffSorted == NULL || CANmodule->rxEffMasked == NULL) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+        CO_CANmodule_disable(CANmodule);
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    for (i = 0U; i < CANmodule->rxEffSize; i++) {
+        memset(&CANmodule->rxEffArray[i], 0, sizeof(CANmodule->rxEffArray[i]));
+    }
 
 #if CO_DRIVER_MULTI_INTERFACE == 0
     /* add one interface */
-    ret = CO_CANmodule_addInterface(CANmodule, CANptrReal->can_ifindex);
+    ret = CO_CANaddInterface(CANmodule, CANptrReal->can_ifindex);
     if (ret != CO_ERROR_NO) {
         CO_CANmodule_disable(CANmodule);
-        return ret;
     }
 #endif
-    return CO_ERROR_NO;
+    return ret;
 }
 
-/* enable socketCAN */
-#if CO_DRIVER_MULTI_INTERFACE == 0
-static
+/* Get string name of the timestamp source */
+static const char*
+CO_CANtimestampName(CO_CANtimestamp_t timestamp) {
+    switch (timestamp) {
+        case CO_CAN_TIMESTAMP_SW: return "software";
+        case CO_CAN_TIMESTAMP_HW: return "hardware";
+        case CO_CAN_TIMESTAMP_HW_RAW: return "raw hardware";
+        default: return "auto";
+    }
+}
+
+/* Check, if CAN interface supports hardware rx timestamps and enable them in the driver. Tx timestamps are enabled
+ * only for tx latency measurement. Return source of timestamps, which will be used on the interface. */
+static CO_CANtimestamp_t
+CO_CANtimestampProbe(CO_CANinterface_t* interface, CO_CANtimestamp_t request, bool_t txStamps) {
+    const uint32_t hwFlags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    struct ethtool_ts_info tsInfo;
+    struct hwtstamp_config hwConfig;
+    struct ifreq ifr;
+
+    if (request == CO_CAN_TIMESTAMP_SW) {
+        return CO_CAN_TIMESTAMP_SW;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    memcpy(ifr.ifr_name, interface->ifName, sizeof(ifr.ifr_name));
+    memset(&tsInfo, 0, sizeof(tsInfo));
+    tsInfo.cmd = ETHTOOL_GET_TS_INFO;
+    ifr.ifr_data = (void*)&tsInfo;
+    if (ioctl(interface->fd, SIOCETHTOOL, &ifr) < 0 || (tsInfo.so_timestamping & hwFlags) != hwFlags) {
+        log_printf(LOG_INFO, CAN_TIMESTAMP_NO_HW, interface->ifName);
+        return CO_CAN_TIMESTAMP_SW;
+    }
+
+    /* Enable hardware timestamping in the driver. This needs CAP_NET_ADMIN, but many CAN drivers timestamp all
+     * messages anyway, so just log the failure. */
+    memset(&hwConfig, 0, sizeof(hwConfig));
+    hwConfig.tx_type = txStamps ? HWTSTAMP_TX_ON : HWTSTAMP_TX_OFF;
+    hwConfig.rx_filter = HWTSTAMP_FILTER_ALL;
+    ifr.ifr_data = (void*)&hwConfig;
+    if (ioctl(interface->fd, SIOCSHWTSTAMP, &ifr) < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "ioctl(SIOCSHWTSTAMP)");
+    }
+
+    return (request == CO_CAN_TIMESTAMP_AUTO) ? CO_CAN_TIMESTAMP_HW_RAW : request;
+}
+
+/* Set socket rx buffer size, privileged first, and read back the actual size */
+static bool_t
+CO_CANsetRxBuffer(CO_CANinterface_t* interface, int bytes) {
+    bool_t ok = true;
+    socklen_t sLen;
+
+    if (bytes > 0) {
+        if (setsockopt(interface->fd, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) < 0
+            && setsockopt(interface->fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) < 0) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt(rcvbuf)");
+            ok = false;
+        }
+    }
+
+    /* print socket rx buffer size in bytes (In my experience, the kernel reserves
+     * around 450 bytes for each CAN message) */
+    sLen = sizeof(interface->rxBufferSize);
+    getsockopt(interface->fd, SOL_SOCKET, SO_RCVBUF, (void*)&interface->rxBufferSize, &sLen);
+    if (sLen == sizeof(interface->rxBufferSize)) {
+        log_printf(LOG_INFO, CAN_SOCKET_BUF_SIZE, interface->ifName, interface->rxBufferSize / 446,
+                   interface->rxBufferSize);
+    }
+
+    return ok;
+}
+
+/* Get number of messages dropped within last CO_DRIVER_RX_DROP_WINDOW seconds */
+static uint32_t
+CO_CANrxDropWindow(const CO_CANinterface_t* interface, uint32_t now_s) {
+    uint32_t sum = 0;
+
+    for (int i = 0; i < CO_DRIVER_RX_DROP_WINDOW; i++) {
+        if ((now_s - interface->rxDropSlots[i].second) < CO_DRIVER_RX_DROP_WINDOW) {
+            sum += interface->rxDropSlots[i].count;
+        }
+    }
+    return sum;
+}
+
+/* Count dropped messages into slot of the current second. Called from rx thread only. */
+static void
+CO_CANrxDropAdd(CO_CANinterface_t* interface, uint32_t now_s, uint32_t count) {
+    uint32_t i = now_s % CO_DRIVER_RX_DROP_WINDOW;
+
+    if (interface->rxDropSlots[i].second != now_s) {
+        interface->rxDropSlots[i].count = 0;
+        interface->rxDropSlots[i].second = now_s;
+    }
+    interface->rxDropSlots[i].count += count;
+}
+
+/* Get current second of CLOCK_MONOTONIC */
+static uint32_t
+CO_CANmonotonicSeconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec;
+}
+
+bool_t
+CO_CANmodule_getRxDrops(CO_CANmodule_t* CANmodule, int can_ifindex, CO_CANrxDropStats_t* stats) {
+    bool_t found = false;
+    uint32_t now_s = CO_CANmonotonicSeconds();
+    uint32_t i;
+
+    if (CANmodule == NULL || stats == NULL) {
+        return false;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        const CO_CANinterface_t* interface = &CANmodule->CANinterfaces[i];
+        if (can_ifindex == 0 || interface->can_ifindex == can_ifindex) {
+            uint32_t dropWindow = CO_CANrxDropWindow(interface, now_s);
+
+            stats->dropCount += interface->rxDropCount;
+            stats->dropWindow += dropWindow;
+            if (CANmodule->rxDropThreshold > 0 && dropWindow > CANmodule->rxDropThreshold) {
+                stats->alarm = true;
+            }
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool_t
+CO_CANmodule_getTxShaper(CO_CANmodule_t* CANmodule, int can_ifindex, CO_CANtxShaperStats_t* stats) {
+    bool_t found = false;
+
+    if (CANmodule == NULL || stats == NULL) {
+        return false;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        struct CO_CANtxShaper* shaper = CANmodule->CANinterfaces[i].txShaper;
+        if (shaper != NULL && (can_ifindex == 0 || CANmodule->CANinterfaces[i].can_ifindex == can_ifindex)) {
+            for (int c = 0; c < CO_CAN_TX_CLASS_COUNT; c++) {
+                stats->deferred[c] += __atomic_load_n(&shaper->deferred[c], __ATOMIC_RELAXED);
+            }
+            stats->loadDeferred += __atomic_load_n(&shaper->loadDeferred, __ATOMIC_RELAXED);
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool_t
+CO_CANmodule_setRxBufferSize(CO_CANmodule_t* CANmodule, int can_ifindex, int bytes, int bytesMax) {
+    bool_t ok = true;
+    uint32_t i;
+
+    if (CANmodule == NULL || bytes < 0) {
+        return false;
+    }
+
+    if (can_ifindex == 0) {
+        CANmodule->rxBufferSize = bytes;
+        CANmodule->rxBufferSizeMax = bytesMax;
+    }
+    for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        CO_CANinterface_t* interface = &CANmodule->CANinterfaces[i];
+        if (can_ifindex == 0 || interface->can_ifindex == can_ifindex) {
+            interface->rxBufferSizeMax = bytesMax;
+            if (!CO_CANsetRxBuffer(interface, bytes)) {
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+#if CO_DRIVER_MULTI_INTERFACE > 0
+bool_t
+CO_CANmodule_addInterface(CO_CANmodule_t* CANmodule, int can_ifindex) {
+    if (CANmodule == NULL) {
+        return false;
+    }
+    return CO_CANaddInterface(CANmodule, can_ifindex) == CO_ERROR_NO;
+}
 #endif
-    CO_ReturnError_t
-    CO_CANmodule_addInterface(CO_CANmodule_t* CANmodule, int can_ifindex) {
+
+/* enable socketCAN */
+/* Add socket and its duplicate to epoll or modify them, epoll_event.data.ptr points to handlers inside the interface.
+ * Registration must be modified, when CANinterfaces is reallocated. */
+static CO_ReturnError_t
+CO_CANepollSet(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, int op) {
+    struct epoll_event ev = {0};
+
+    interface->rxHandler.fd = interface->fd;
+    interface->rxHandler.type = CO_EPOLL_HANDLER_CAN_RX;
+    interface->rxHandler.object = CANmodule;
+    interface->txHandler.fd = interface->txFd;
+    interface->txHandler.type = CO_EPOLL_HANDLER_CAN_TX;
+    interface->txHandler.object = CANmodule;
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = &interface->rxHandler;
+    if (epoll_ctl(CANmodule->epoll_fd, op, interface->fd, &ev) < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "epoll_ctl(can)");
+        return CO_ERROR_SYSCALL;
+    }
+    ev.events = interface->txWait ? (EPOLLOUT | EPOLLET) : EPOLLET;
+    ev.data.ptr = &interface->txHandler;
+    if (epoll_ctl(CANmodule->epoll_fd, op, interface->txFd, &ev) < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "epoll_ctl(can tx)");
+        return CO_ERROR_SYSCALL;
+    }
+    return CO_ERROR_NO;
+}
+
+static CO_ReturnError_t
+CO_CANaddInterface(CO_CANmodule_t* CANmodule, int can_ifindex) {
     int32_t ret;
     int32_t tmp;
-    int32_t bytes;
     char* ifName;
-    socklen_t sLen;
     CO_CANinterface_t* interface;
     struct sockaddr_can sockAddr;
-    struct epoll_event ev = {0};
 #if CO_DRIVER_ERROR_REPORTING > 0
     can_err_mask_t err_mask;
 #endif
@@ -247,15 +1632,86 @@ static
         return CO_ERROR_INVALID_STATE;
     }
 
-    /* Add interface to interface list */
+    /* Add interface to interface list. New slot is initialized before anything can fail, so CO_CANmodule_disable()
+     * can always clean up all counted interfaces. */
+    interface = realloc(CANmodule->CANinterfaces, (CANmodule->CANinterfaceCount + 1U) * sizeof(*interface));
+    if (interface == NULL) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    CANmodule->CANinterfaces = interface;
+    interface = &CANmodule->CANinterfaces[CANmodule->CANinterfaceCount];
+    memset(interface, 0, sizeof(*interface));
+    interface->fd = -1;
+    interface->txFd = -1;
     CANmodule->CANinterfaceCount++;
-    CANmodule->CANinterfaces = realloc(CANmodule->CANinterfaces,
-                                       ((CANmodule->CANinterfaceCount) * sizeof(*CANmodule->CANinterfaces)));
-    if (CANmodule->CANinterfaces == NULL) {
+
+    for (uint32_t i = 0; i + 1U < CANmodule->CANinterfaceCount; i++) {
+        /* interfaces have moved, update pointers to their epoll handlers */
+        if (CANmodule->CANinterfaces[i].fd >= 0 && CANmodule->CANinterfaces[i].txFd >= 0
+            && CO_CANepollSet(CANmodule, &CANmodule->CANinterfaces[i], EPOLL_CTL_MOD) != CO_ERROR_NO) {
+            return CO_ERROR_SYSCALL;
+        }
+    }
+
+    /* prepare queue for tx buffers, which will wait for free space in socket */
+    size_t txQueueSize = sizeof(struct CO_CANtxEntry) + 2U * sizeof(uint16_t) + sizeof(uint8_t);
+    interface->txQueue = calloc(1, sizeof(struct CO_CANtxQueue) + CANmodule->txSize * txQueueSize);
+    if (interface->txQueue == NULL) {
         log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
         return CO_ERROR_OUT_OF_MEMORY;
     }
-    interface = &CANmodule->CANinterfaces[CANmodule->CANinterfaceCount - 1];
+    interface->txQueue->heap = (uint16_t*)&interface->txQueue->entries[CANmodule->txSize];
+    interface->txQueue->position = &interface->txQueue->heap[CANmodule->txSize];
+    interface->txQueue->deferred = (uint8_t*)&interface->txQueue->position[CANmodule->txSize];
+    for (uint16_t i = 0U; i < CANmodule->txSize; i++) {
+        interface->txQueue->position[i] = CO_CAN_TX_NOT_QUEUED;
+    }
+
+#if CO_DRIVER_TX_BATCH > 1
+    /* prepare staging queue for sendmmsg() */
+    interface->txBatch = calloc(1, sizeof(struct CO_CANtxBatch));
+    if (interface->txBatch == NULL) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    for (uint32_t i = 0U; i < CO_DRIVER_TX_BATCH; i++) {
+        struct CO_CANtxBatch* batch = interface->txBatch;
+
+        batch->iov[i].iov_base = &batch->entries[i].buffer;
+        batch->msgs[i].msg_hdr.msg_iov = &batch->iov[i];
+        batch->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+
+    if (CANmodule->txLatency) {
+        interface->txStampFifo = calloc(1, sizeof(struct CO_CANtxStampFifo));
+        if (interface->txStampFifo == NULL) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+            return CO_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
+    /* tx shaper, buckets start full */
+    bool_t shaped = CANmodule->txLoadRate > 0;
+    for (int c = 0; c < CO_CAN_TX_CLASS_COUNT; c++) {
+        shaped = shaped || CANmodule->txClassRate[c] > 0;
+    }
+    if (shaped) {
+        struct CO_CANtxShaper* shaper = calloc(1, sizeof(struct CO_CANtxShaper));
+        if (shaper == NULL) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+            return CO_ERROR_OUT_OF_MEMORY;
+        }
+        for (int c = 0; c < CO_CAN_TX_CLASS_COUNT; c++) {
+            if (CANmodule->txClassRate[c] > 0) {
+                shaper->classCredit_ns[c] = CO_CANtxClassBurst(CANmodule, c) * CO_CANtxClassCost(CANmodule, c);
+            }
+        }
+        shaper->busCredit_ns = CO_CAN_TX_LOAD_WINDOW_NS;
+        shaper->last_ns = CO_CANtxClockNow();
+        interface->txShaper = shaper;
+    }
 
     interface->can_ifindex = can_ifindex;
     ifName = if_indextoname(can_ifindex, interface->ifName);
@@ -271,6 +1727,24 @@ static
         return CO_ERROR_SYSCALL;
     }
 
+#if CO_DRIVER_CANFD > 0
+    /* enable CAN FD frames, interface must have CANFD_MTU to send them */
+    tmp = 1;
+    ret = setsockopt(interface->fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &tmp, sizeof(tmp));
+    if (ret < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt(fd frames)");
+        return CO_ERROR_SYSCALL;
+    }
+    {
+        struct ifreq ifr;
+        memset(&ifr, 0, sizeof(ifr));
+        memcpy(ifr.ifr_name, interface->ifName, sizeof(ifr.ifr_name));
+        if (ioctl(interface->fd, SIOCGIFMTU, &ifr) == 0 && ifr.ifr_mtu != CANFD_MTU) {
+            log_printf(LOG_WARNING, CAN_NO_FD_MTU, interface->ifName, ifr.ifr_mtu);
+        }
+    }
+#endif
+
     /* enable socket rx queue overflow detection */
     tmp = 1;
     ret = setsockopt(interface->fd, SOL_SOCKET, SO_RXQ_OVFL, &tmp, sizeof(tmp));
@@ -279,24 +1753,68 @@ static
         return CO_ERROR_SYSCALL;
     }
 
-    /* enable software time stamp mode (hardware timestamps do not work properly on all devices) */
+    /* Enable time stamps. Software time stamps are always enabled, they are used, if message has no hardware time
+     * stamp. Hardware timestamps do not work properly on all devices, they are used only if supported. */
+    interface->timestamp = CO_CANtimestampProbe(interface, CANmodule->timestamp, CANmodule->txLatency);
+    interface->tsOffset_ns = 0;
+    interface->tsOffsetMin_ns = INT64_MAX;
+    interface->tsWindowStart_ns = 0;
     tmp = (SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE);
-    ret = setsockopt(interface->fd, SOL_SOCKET, SO_TIMESTAMPING, &tmp, sizeof(tmp));
-    if (ret < 0) {
-        log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt(timestamping)");
-        return CO_ERROR_SYSCALL;
+    if (interface->timestamp != CO_CAN_TIMESTAMP_SW) {
+        tmp |= SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+        if (CANmodule->txLatency) {
+            /* single tx timestamp per message, from the same clock as rx timestamps */
+            tmp |= SOF_TIMESTAMPING_TX_HARDWARE;
+        }
+        ret = setsockopt(interface->fd, SOL_SOCKET, SO_TIMESTAMPING, &tmp, sizeof(tmp));
+        if (ret < 0) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt(hw timestamping)");
+            interface->timestamp = CO_CAN_TIMESTAMP_SW;
+            tmp = (SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE);
+        }
+    }
+    if (interface->timestamp == CO_CAN_TIMESTAMP_SW) {
+        if (CANmodule->txLatency) {
+            tmp |= SOF_TIMESTAMPING_TX_SOFTWARE;
+        }
+        ret = setsockopt(interface->fd, SOL_SOCKET, SO_TIMESTAMPING, &tmp, sizeof(tmp));
+        if (ret < 0) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt(timestamping)");
+            return CO_ERROR_SYSCALL;
+        }
     }
+    log_printf(LOG_INFO, CAN_TIMESTAMP_SOURCE, interface->ifName, CO_CANtimestampName(interface->timestamp));
 
-    // todo - modify rx buffer size? first one needs root
-    // ret = setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, (void *)&bytes, sLen);
-    // ret = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (void *)&bytes, sLen);
+    /* Enable launch time for time triggered transmission, ETF qdisc must be configured on the interface with the same
+     * clock. Failure is not fatal, messages are sent immediately then. */
+    if (CANmodule->txTimeOffset_us > 0) {
+        struct sock_txtime txtime = {.clockid = CLOCK_TAI, .flags = 0};
 
-    /* print socket rx buffer size in bytes (In my experience, the kernel reserves
-     * around 450 bytes for each CAN message) */
-    sLen = sizeof(bytes);
-    getsockopt(interface->fd, SOL_SOCKET, SO_RCVBUF, (void*)&bytes, &sLen);
-    if (sLen == sizeof(bytes)) {
-        log_printf(LOG_INFO, CAN_SOCKET_BUF_SIZE, interface->ifName, bytes / 446, bytes);
+        ret = setsockopt(interface->fd, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime));
+        if (ret < 0) {
+            log_printf(LOG_WARNING, CAN_TXTIME_FAILED, interface->ifName);
+            log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt(txtime)");
+        } else {
+            interface->txTime = true;
+        }
+    }
+
+    interface->rxDropCount = 0;
+    memset(interface->rxDropSlots, 0, sizeof(interface->rxDropSlots));
+
+    /* set rx buffer size, failure is not fatal, default size is used then */
+    interface->rxBufferSizeMax = CANmodule->rxBufferSizeMax;
+    (void)CO_CANsetRxBuffer(interface, CANmodule->rxBufferSize);
+
+    /* Busy poll device queue on receive, for use with CO_epoll_t spin mode on isolated core. Raising it above
+     * net.core.busy_read requires CAP_NET_ADMIN, failure is not fatal. */
+    if (CANmodule->rxBusyPoll_us > 0) {
+        tmp = CANmodule->rxBusyPoll_us;
+        ret = setsockopt(interface->fd, SOL_SOCKET, SO_BUSY_POLL, &tmp, sizeof(tmp));
+        if (ret < 0) {
+            log_printf(LOG_WARNING, CAN_BUSY_POLL_FAILED, interface->ifName);
+            log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt(busy poll)");
+        }
     }
 
     /* bind socket */
@@ -326,14 +1844,17 @@ static
     }
 #endif /* CO_DRIVER_ERROR_REPORTING */
 
-    /* Add socket to epoll */
-    ev.events = EPOLLIN;
-    ev.data.fd = interface->fd;
-    ret = epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev);
-    if (ret < 0) {
-        log_printf(LOG_DEBUG, DBG_ERRNO, "epoll_ctl(can)");
+    /* Add socket and its duplicate to epoll, duplicate waits for free space in tx queue. Separate entry allows edge
+     * triggered EPOLLOUT, while rx stays level triggered. EPOLLOUT is armed by CO_CANtxWaitSet() */
+    interface->txFd = dup(interface->fd);
+    if (interface->txFd < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "dup(can)");
         return CO_ERROR_SYSCALL;
     }
+    ret = CO_CANepollSet(CANmodule, interface, EPOLL_CTL_ADD);
+    if (ret != CO_ERROR_NO) {
+        return ret;
+    }
 
     /* rx is started by calling #CO_CANsetNormalMode() */
     ret = disableRx(CANmodule);
@@ -359,20 +1880,88 @@ CO_CANmodule_disable(CO_CANmodule_t* CANmodule) {
         CO_CANerror_disable(&interface->errorhandler);
 #endif
 
-        epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_DEL, interface->fd, NULL);
-        close(interface->fd);
-        interface->fd = -1;
+        if (interface->txFd >= 0) {
+            epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_DEL, interface->txFd, NULL);
+            close(interface->txFd);
+            interface->txFd = -1;
+        }
+        if (interface->fd >= 0) {
+            epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_DEL, interface->fd, NULL);
+            close(interface->fd);
+            interface->fd = -1;
+        }
+        free(interface->txQueue);
+        interface->txQueue = NULL;
+#if CO_DRIVER_TX_BATCH > 1
+        free(interface->txBatch);
+        interface->txBatch = NULL;
+#endif
+        free(interface->txStampFifo);
+        interface->txStampFifo = NULL;
+        free(interface->txShaper);
+        interface->txShaper = NULL;
     }
+    CANmodule->CANtxCount = 0;
     CANmodule->CANinterfaceCount = 0;
     if (CANmodule->CANinterfaces != NULL) {
         free(CANmodule->CANinterfaces);
     }
     CANmodule->CANinterfaces = NULL;
+#if CO_DRIVER_MULTI_INTERFACE > 0
+    free(CANmodule->txRoutes);
+    CANmodule->txRoutes = NULL;
+#endif
 
     if (CANmodule->rxFilter != NULL) {
         free(CANmodule->rxFilter);
     }
     CANmodule->rxFilter = NULL;
+
+    if (CANmodule->rxMasked != NULL) {
+        free(CANmodule->rxMasked);
+    }
+    CANmodule->rxMasked = NULL;
+    CANmodule->rxMaskedCount = 0;
+
+    if (CANmodule->rxEffSorted != NULL) {
+        free(CANmodule->rxEffSorted);
+    }
+    CANmodule->rxEffSorted = NULL;
+    if (CANmodule->rxEffMasked != NULL) {
+        free(CANmodule->rxEffMasked);
+    }
+    CANmodule->rxEffMasked = NULL;
+    CANmodule->rxEffSortedCount = 0;
+    CANmodule->rxEffMaskedCount = 0;
+
+#if CO_DRIVER_RX_BATCH > 1
+    if (CANmodule->rxBatch != NULL) {
+        free(CANmodule->rxBatch);
+    }
+    CANmodule->rxBatch = NULL;
+#endif
+
+    if (CANmodule->txStamps != NULL) {
+        free(CANmodule->txStamps);
+    }
+    CANmodule->txStamps = NULL;
+
+    if (CANmodule->txPending != NULL) {
+        free(CANmodule->txPending);
+    }
+    CANmodule->txPending = NULL;
+
+#ifndef CO_SINGLE_THREAD
+    if (CANmodule->txEventFd >= 0) {
+        (void)epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_DEL, CANmodule->txEventFd, NULL);
+        close(CANmodule->txEventFd);
+    }
+    CANmodule->txEventFd = -1;
+    if (CANmodule->txRings != NULL) {
+        free(CANmodule->txRings);
+    }
+    CANmodule->txRings = NULL;
+#endif
 }
 
 CO_ReturnError_t
@@ -382,13 +1971,13 @@ CO_CANrxBufferInit(CO_CANmodule_t* CANmodule, uint16_t index, uint16_t ident, ui
 
     if ((CANmodule != NULL) && (index < CANmodule->rxSize)) {
         CO_CANrx_t* buffer;
+        uint32_t identOld;
+        bool_t exactOld;
 
         /* buffer, which will be configured */
         buffer = &CANmodule->rxArray[index];
-
-#if CO_DRIVER_MULTI_INTERFACE > 0
-        CO_CANsetIdentToIndex(CANmodule->rxIdentToIndex, index, ident, buffer->ident);
-#endif
+        identOld = buffer->ident;
+        exactOld = CO_CANrxIsExact(buffer);
 
         /* Configure object variables */
         buffer->object = object;
@@ -403,12 +1992,14 @@ CO_CANrxBufferInit(CO_CANmodule_t* CANmodule, uint16_t index, uint16_t ident, ui
             buffer->ident |= CAN_RTR_FLAG;
         }
         buffer->mask = (mask & CAN_SFF_MASK) | CAN_EFF_FLAG | CAN_RTR_FLAG;
+        CO_CANrxLookupUpdate(CANmodule, index, identOld, exactOld);
 
         /* Set CAN hardware module filter and mask. */
         CANmodule->rxFilter[index].can_id = buffer->ident;
         CANmodule->rxFilter[index].can_mask = buffer->mask;
         if (CANmodule->CANnormal) {
-            ret = setRxFilters(CANmodule);
+            /* installed later, see CO_CANmodule_rxFiltersBegin() */
+            CANmodule->rxFilterDirty = true;
         }
     } else {
         log_printf(LOG_DEBUG, DBG_CAN_RX_PARAM_FAILED, "illegal argument");
@@ -418,6 +2009,67 @@ CO_CANrxBufferInit(CO_CANmodule_t* CANmodule, uint16_t index, uint16_t ident, ui
     return ret;
 }
 
+bool_t
+CO_CANrxBufferInitEff(CO_CANmodule_t* CANmodule, uint16_t index, uint32_t ident, uint32_t mask, bool_t rtr,
+                      void* object, void (*CANrx_callback)(void* object, void* message)) {
+    CO_CANrx_t* buffer;
+
+    if (CANmodule == NULL || index >= CANmodule->rxEffSize) {
+        log_printf(LOG_DEBUG, DBG_CAN_RX_PARAM_FAILED, "illegal argument");
+        return false;
+    }
+
+    /* Configure object variables */
+    buffer = &CANmodule->rxEffArray[index];
+    buffer->object = object;
+    buffer->CANrx_callback = CANrx_callback;
+    buffer->can_ifindex = 0;
+    buffer->timestamp.tv_nsec = 0;
+    buffer->timestamp.tv_sec = 0;
+
+    /* CAN identifier and CAN mask, bit aligned with socketCAN */
+    buffer->ident = (ident & CAN_EFF_MASK) | CAN_EFF_FLAG;
+    if (rtr) {
+        buffer->ident |= CAN_RTR_FLAG;
+    }
+    buffer->mask = (mask & CAN_EFF_MASK) | CAN_EFF_FLAG | CAN_RTR_FLAG;
+    CO_CANrxEffLookupUpdate(CANmodule);
+
+    if (CANmodule->CANnormal) {
+        CANmodule->rxFilterDirty = true;
+    }
+    return true;
+}
+
+void
+CO_CANmodule_rxFiltersBegin(CO_CANmodule_t* CANmodule) {
+    if (CANmodule != NULL) {
+        CANmodule->rxFilterHold++;
+    }
+}
+
+bool_t
+CO_CANmodule_rxFiltersCommit(CO_CANmodule_t* CANmodule) {
+    if (CANmodule == NULL) {
+        return false;
+    }
+    if (CANmodule->rxFilterHold > 0) {
+        CANmodule->rxFilterHold--;
+    }
+    if (CANmodule->rxFilterHold == 0 && CANmodule->rxFilterDirty && CANmodule->CANnormal) {
+        return setRxFilters(CANmodule) == CO_ERROR_NO;
+    }
+    return true;
+}
+
+uint32_t
+CO_CANmodule_rxFiltersNext_us(CO_CANmodule_t* CANmodule) {
+    if (CANmodule == NULL || !CANmodule->rxFilterDirty || CANmodule->rxFilterHold > 0 || !CANmodule->CANnormal) {
+        return UINT32_MAX;
+    }
+    return CANmodule->rxFilterFailed ? CO_CAN_RX_FILTER_RETRY_US : 0;
+}
+
 #if CO_DRIVER_MULTI_INTERFACE > 0
 
 bool_t
@@ -428,8 +2080,8 @@ CO_CANrxBuffer_getInterface(CO_CANmodule_t* CANmodule, uint16_t ident, int* can_
         return false;
     }
 
-    const uint32_t index = CO_CANgetIndexFromIdent(CANmodule->rxIdentToIndex, ident);
-    if ((index == CO_INVALID_COB_ID) || (index > CANmodule->rxSize)) {
+    const uint16_t index = CO_CANrxLookup(CANmodule, ident & CAN_SFF_MASK);
+    if ((index == CO_CAN_RX_INDEX_NONE) || (index >= CANmodule->rxSize)) {
         return false;
     }
     buffer = &CANmodule->rxArray[index];
@@ -463,6 +2115,7 @@ CO_CANtxBufferInit(CO_CANmodule_t* CANmodule, uint16_t index, uint16_t ident, bo
         CO_CANsetIdentToIndex(CANmodule->txIdentToIndex, index, ident, buffer->ident);
 #endif
 
+        /* copies, which still wait in the driver, keep their identifier, bufferFull is cleared by the tx consumer */
         buffer->can_ifindex = 0;
 
         /* CAN identifier and rtr */
@@ -471,7 +2124,9 @@ CO_CANtxBufferInit(CO_CANmodule_t* CANmodule, uint16_t index, uint16_t ident, bo
             buffer->ident |= CAN_RTR_FLAG;
         }
         buffer->DLC = noOfBytes;
-        buffer->bufferFull = false;
+#if CO_DRIVER_CANFD > 0
+        buffer->flags = (noOfBytes > CAN_MAX_DLEN) ? (CANFD_FDF | CANFD_BRS) : 0;
+#endif
         buffer->syncFlag = syncFlag;
     }
 
@@ -480,204 +2135,627 @@ CO_CANtxBufferInit(CO_CANmodule_t* CANmodule, uint16_t index, uint16_t ident, bo
 
 #if CO_DRIVER_MULTI_INTERFACE > 0
 
-CO_ReturnError_t
+bool_t
 CO_CANtxBuffer_setInterface(CO_CANmodule_t* CANmodule, uint16_t ident, int can_ifindexTx) {
-    if (CANmodule != NULL) {
-        uint32_t index;
+    uint32_t index;
+    bool_t found = false;
+
+    if (CANmodule == NULL) {
+        return false;
+    }
+    index = CO_CANgetIndexFromIdent(CANmodule->txIdentToIndex, ident);
+    if ((index == CO_INVALID_COB_ID) || (index >= CANmodule->txSize)) {
+        return false;
+    }
+
+    /* unknown interface means all interfaces */
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        if (CANmodule->CANinterfaces[i].can_ifindex == can_ifindexTx) {
+            found = true;
+        }
+    }
+    CANmodule->txArray[index].can_ifindex = found ? can_ifindexTx : 0;
+
+    return true;
+}
+
+bool_t
+CO_CANmodule_setTxRoutes(CO_CANmodule_t* CANmodule, const CO_CANtxRoute_t routes[], uint16_t count) {
+    struct CO_CANtxRoutes* table = NULL;
+    uint32_t added;
+
+    if (CANmodule == NULL || CANmodule->CANnormal || (routes == NULL && count > 0) || count > 255U) {
+        return false;
+    }
+
+    added = (CANmodule->CANinterfaceCount >= 32U) ? CO_CAN_TX_ROUTE_ALL : ((1UL << CANmodule->CANinterfaceCount) - 1U);
+    for (uint16_t r = 0; r < count; r++) {
+        if (routes[r].identFirst > routes[r].identLast || routes[r].identLast >= CO_CAN_MSG_SFF_MAX_COB_ID
+            || (routes[r].interfaces & added) == 0U) {
+            return false;
+        }
+    }
 
-        index = CO_CANgetIndexFromIdent(CANmodule->txIdentToIndex, ident);
-        if ((index == CO_INVALID_COB_ID) || (index > CANmodule->txSize)) {
-            return CO_ERROR_ILLEGAL_ARGUMENT;
+    if (count > 0) {
+        table = calloc(1, sizeof(*table) + count * sizeof(table->routes[0]));
+        if (table == NULL) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+            return false;
         }
-        CANmodule->txArray[index].can_ifindex = can_ifindexTx;
+        memcpy(table->routes, routes, count * sizeof(table->routes[0]));
+        table->count = count;
 
-        return CO_ERROR_NO;
+        /* first matching entry has precedence, fill in reverse order */
+        for (uint16_t r = count; r > 0; r--) {
+            for (uint32_t ident = routes[r - 1U].identFirst; ident <= routes[r - 1U].identLast; ident++) {
+                table->lookup[ident] = (uint8_t)r;
+            }
+        }
     }
-    return CO_ERROR_ILLEGAL_ARGUMENT;
+
+    free(CANmodule->txRoutes);
+    CANmodule->txRoutes = table;
+    return true;
 }
 
 #endif /* CO_DRIVER_MULTI_INTERFACE */
+
+/* Remember message written to the socket, tx consumer only. It is matched with tx timestamp by CO_CANtxStampRead() */
+static void
+CO_CANtxStampPush(struct CO_CANtxStampFifo* fifo, uint32_t ident, int64_t send_ns) {
+    uint32_t tail = (fifo->head + fifo->count) % CO_CAN_TX_STAMP_FIFO;
+
+    if (fifo->count == CO_CAN_TX_STAMP_FIFO) {
+        /* overwrite the oldest entry */
+        fifo->head = (fifo->head + 1U) % CO_CAN_TX_STAMP_FIFO;
+        fifo->count--;
+    }
+    fifo->entries[tail].ident = ident;
+    fifo->entries[tail].send_ns = send_ns;
+    fifo->count++;
+}
+
+/* Account message, which was written to the socket of the interface, tx consumer only. Staged message is accounted by
+ * CO_CANtxBatchWrite(), when socket accepts it. */
+static void
+CO_CANtxSent(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, const struct CO_CANtxEntry* entry) {
+#if CO_DRIVER_MULTI_INTERFACE > 0
+    if (CANmodule->txRoutes != NULL) {
+        CO_CANtxLoadRotate(interface, CO_CANtxClockNow());
+        interface->txLoadBits[0] += CO_CANtxFrameBits(&entry->buffer);
+    }
+#else
+    (void)CANmodule;
+#endif
+    if (interface->txStampFifo != NULL) {
+        CO_CANtxStampPush(interface->txStampFifo, entry->buffer.ident, entry->send_ns);
+    }
+}
+
+#if CO_DRIVER_TX_BATCH > 1
+/* Release staged message, which will not be written, tx consumer only. Credit of tx shaper is returned. */
+static void
+CO_CANtxBatchDrop(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, const struct CO_CANtxEntry* entry) {
+    if (interface->txShaper != NULL) {
+        CO_CANtxShaperCharge(CANmodule, interface->txShaper, &entry->buffer, -1);
+    }
+    CO_CANtxPendingAdd(CANmodule, entry->index, -1);
+}
+
+/* Write staged messages of the interface with sendmmsg() calls, tx consumer only. Each message accepted by the socket
+ * is accounted and released. Messages, which were not accepted, because socket is full, are moved to the beginning of
+ * the queue and are written by next flush. Message, which failed with other error, is dropped. Return number of
+ * messages remaining in the queue. */
+static uint32_t
+CO_CANtxBatchWrite(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface) {
+    struct CO_CANtxBatch* batch = interface->txBatch;
+    uint32_t done = 0;
+
+    if (batch == NULL || batch->count == 0) {
+        return 0;
+    }
+
+    if (interface->txTime) {
+        /* messages may wait in the queue, launch time must not be in the past */
+        int64_t monoToTai_ns;
+        int64_t mono_ns = CO_CANtxTimeNow(&monoToTai_ns);
+        uint64_t earliest = (uint64_t)(mono_ns + monoToTai_ns + CO_DRIVER_TXTIME_MARGIN * 1000LL);
+
+        for (uint32_t i = 0; i < batch->count; i++) {
+            if (batch->txtime[i] < earliest) {
+                batch->txtime[i] = earliest;
+            }
+            CO_CANtxTimeCmsg(&batch->msgs[i].msg_hdr, batch->ctrlmsg[i], batch->txtime[i]);
+        }
+    }
+
+    while (done < batch->count) {
+        int n = sendmmsg(interface->fd, &batch->msgs[done], batch->count - done, MSG_DONTWAIT);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == ENOBUFS) {
+                /* socket tx queue full, retry on next flush */
+                break;
+            }
+            /* Unknown error, drop the message, which was not accepted */
+            log_printf(LOG_DEBUG, DBG_ERRNO, "sendmmsg()");
+#if CO_DRIVER_ERROR_REPORTING > 0
+            interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_OVERFLOW;
+#endif
+            CO_CANtxBatchDrop(CANmodule, interface, &batch->entries[done]);
+            done++;
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            CO_CANtxSent(CANmodule, interface, &batch->entries[done]);
+            CO_CANtxPendingAdd(CANmodule, batch->entries[done].index, -1);
+            done++;
+        }
+    }
+
+    /* keep unsent messages in original order */
+    for (uint32_t i = done; i < batch->count; i++) {
+        uint32_t j = i - done;
+        batch->entries[j] = batch->entries[i];
+        batch->iov[j].iov_len = batch->iov[i].iov_len;
+        batch->txtime[j] = batch->txtime[i];
+    }
+    __atomic_store_n(&batch->count, batch->count - done, __ATOMIC_RELAXED);
+    if (batch->count > 0) {
+        CO_CANtxWaitSet(CANmodule, interface, true);
+    }
+    return batch->count;
+}
+
+/* Copy message into staging queue of the interface, tx consumer only. Same return value and errno as send(), EAGAIN if
+ * queue is full. */
+static ssize_t
+CO_CANtxStage(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, const struct CO_CANtxEntry* entry, ssize_t mtu,
+              uint64_t txtime) {
+    struct CO_CANtxBatch* batch = interface->txBatch;
+
+    if (batch->count >= CO_DRIVER_TX_BATCH) {
+        (void)CO_CANtxBatchWrite(CANmodule, interface);
+    }
+    if (batch->count >= CO_DRIVER_TX_BATCH) {
+        errno = EAGAIN;
+        return -1;
+    }
+    batch->entries[batch->count] = *entry;
+    batch->iov[batch->count].iov_len = (size_t)mtu;
+    batch->txtime[batch->count] = txtime;
+    __atomic_store_n(&batch->count, batch->count + 1U, __ATOMIC_RELAXED);
+    /* staged copy is pending, until it is written or dropped */
+    CO_CANtxPendingAdd(CANmodule, entry->index, 1);
+    return mtu;
+}
+#endif /* CO_DRIVER_TX_BATCH > 1 */
+
+/* Send copy of CAN message on one interface, tx consumer only. If socket is full, copy is added to the tx queue of the
+ * interface and is re-sent, when socket becomes writable or by CO_CANmodule_process(). So congested interface does not
+ * block other interfaces. Message over the limit of tx shaper is also queued, CO_ERROR_TIMEOUT is returned, if there
+ * is no more severe error. Retry is true for message from the tx queue, it is counted as deferred only once, also if
+ * it was queued for full socket. */
+static CO_ReturnError_t
+CO_CANsendInterface(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, const struct CO_CANtxEntry* entry,
+                    bool_t retry) {
+    CO_ReturnError_t err = CO_ERROR_NO;
+    const CO_CANtx_t* buffer = &entry->buffer;
+    uint16_t index = entry->index;
+
+    if (interface->fd < 0) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+#if CO_DRIVER_ERROR_REPORTING > 0 && CO_DRIVER_MULTI_INTERFACE > 0
+    /* Interface in listen only mode (bus off or no ack) does not collect messages, other interfaces may work */
+    switch (CO_CANerror_txMsg(&interface->errorhandler)) {
+        case CO_INTERFACE_ACTIVE: break;
+        case CO_INTERFACE_LISTEN_ONLY: CO_CANtxQueueDrop(CANmodule, interface, index); return CO_ERROR_NO;
+        default: return CO_ERROR_INVALID_STATE;
+    }
+#endif
+
+    /* Verify overflow, previous message is still waiting on this interface. Message, which waits for credit of tx
+     * shaper, is not lost, newer message from the same tx buffer replaces it in the tx queue. */
+    if (interface->txQueue->position[index] != CO_CAN_TX_NOT_QUEUED && !interface->txQueue->deferred[index]) {
+#if CO_DRIVER_ERROR_REPORTING > 0
+        interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_OVERFLOW;
+#endif
+        log_printf(LOG_ERR, DBG_CAN_TX_FAILED, buffer->ident, interface->ifName);
+        err = CO_ERROR_TX_OVERFLOW;
+    }
+
+    if (!retry) {
+        interface->txQueue->deferred[index] = false;
+    }
+    int64_t next_ns;
+    if (interface->txShaper != NULL
+        && !CO_CANtxShaperAllow(CANmodule, interface->txShaper, buffer, interface->txQueue->deferred[index],
+                                &next_ns)) {
+        CO_CANtxQueuePut(CANmodule, interface, entry);
+        interface->txQueue->deferred[index] = true;
+        /* mainline wakes up at the earliest credit time, see CO_CANmodule_txShaperNext_us() */
+        if (CANmodule->txShaperNext_ns == 0 || next_ns < CANmodule->txShaperNext_ns) {
+            __atomic_store_n(&CANmodule->txShaperNext_ns, next_ns, __ATOMIC_RELAXED);
+        }
+        return (err != CO_ERROR_NO) ? err : CO_ERROR_TIMEOUT;
+    }
+
+    errno = 0;
+    ssize_t mtu = CO_CANtxMtu(buffer);
+    uint64_t txtime = CO_CANtxTimeLaunch(CANmodule, interface, buffer);
+#if CO_DRIVER_TX_BATCH > 1
+    /* message is written to the socket by CO_CANmodule_txFlush() */
+    ssize_t n = CO_CANtxStage(CANmodule, interface, entry, mtu, txtime);
+#else
+    ssize_t n;
+    if (txtime != 0) {
+        struct iovec iov = {.iov_base = (void*)buffer, .iov_len = (size_t)mtu};
+        struct msghdr msghdr = {0};
+        char ctrlmsg[CO_CAN_TXTIME_CMSG_SIZE];
+
+        msghdr.msg_iov = &iov;
+        msghdr.msg_iovlen = 1;
+        CO_CANtxTimeCmsg(&msghdr, ctrlmsg, txtime);
+        n = sendmsg(interface->fd, &msghdr, MSG_DONTWAIT);
+    } else {
+        n = send(interface->fd, buffer, mtu, MSG_DONTWAIT);
+    }
+#endif
+    if (errno == 0 && n == mtu) {
+        /* success, also staged message takes credit of tx shaper now, so staged messages do not exceed the limit */
+        CO_CANtxQueueDrop(CANmodule, interface, index);
+        if (interface->txShaper != NULL) {
+            CO_CANtxShaperCharge(CANmodule, interface->txShaper, buffer, 1);
+        }
+#if CO_DRIVER_TX_BATCH <= 1
+        CO_CANtxSent(CANmodule, interface, entry);
+#endif
+    } else if (errno == EINTR || errno == EAGAIN || errno == ENOBUFS) {
+        /* Send failed, message will be re-sent */
+        CO_CANtxQueuePut(CANmodule, interface, entry);
+        if (err == CO_ERROR_NO) {
+            err = CO_ERROR_TX_BUSY;
+        }
+    } else {
+        /* Unknown error */
+        log_printf(LOG_DEBUG, DBG_ERRNO, "send()");
+#if CO_DRIVER_ERROR_REPORTING > 0
+        interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_OVERFLOW;
+#endif
+        CO_CANtxQueueDrop(CANmodule, interface, index);
+        err = CO_ERROR_SYSCALL;
+    }
+
+    return err;
+}
+
 #if CO_DRIVER_MULTI_INTERFACE > 0
+/* Error returned by CO_CANsend() for more interfaces is the most severe one */
+static CO_ReturnError_t
+CO_CANtxErrorMerge(CO_ReturnError_t err, CO_ReturnError_t errInterface) {
+    static const CO_ReturnError_t order[] = {CO_ERROR_NO, CO_ERROR_TX_BUSY, CO_ERROR_TIMEOUT, CO_ERROR_TX_OVERFLOW,
+                                             CO_ERROR_INVALID_STATE};
+    size_t i, severity = 5, severityInterface = 5;
+
+    for (i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+        if (err == order[i]) {
+            severity = i;
+        }
+        if (errInterface == order[i]) {
+            severityInterface = i;
+        }
+    }
+    return (severityInterface > severity) ? errInterface : err;
+}
+#endif
 
-/* send CAN message */
+/* Send copy of CAN message on selected interface, on interfaces from routing table or on all interfaces, tx consumer
+ * only. Return the most severe error. */
 static CO_ReturnError_t
-CO_CANCheckSendInterface(CO_CANmodule_t* CANmodule, CO_CANtx_t* buffer, CO_CANinterface_t* interface) {
+CO_CANtxSend(CO_CANmodule_t* CANmodule, const struct CO_CANtxEntry* entry) {
     CO_ReturnError_t err = CO_ERROR_NO;
+
+    if (CANmodule->CANinterfaceCount == 0) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+#if CO_DRIVER_MULTI_INTERFACE > 0
+    int can_ifindex = entry->buffer.can_ifindex;
+    uint32_t route = (can_ifindex == 0) ? CO_CANtxRoute(CANmodule, &entry->buffer) : CO_CAN_TX_ROUTE_ALL;
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        CO_CANinterface_t* interface = &CANmodule->CANinterfaces[i];
+
+        if ((can_ifindex == 0 && CO_CANtxRouteHas(route, i)) || can_ifindex == interface->can_ifindex) {
+            err = CO_CANtxErrorMerge(err, CO_CANsendInterface(CANmodule, interface, entry, false));
+        }
+    }
+#else
+    err = CO_CANsendInterface(CANmodule, &CANmodule->CANinterfaces[0], entry, false);
+#endif
+    return err;
+}
+
+/* Remove synchronous messages from tx and staging queues of all interfaces, tx consumer only. CO_CAN_ERRTX_PDO_LATE
+ * is indicated, if any was removed, and cleared after SYNC window without late messages. */
+static void
+CO_CANtxPurgeSync(CO_CANmodule_t* CANmodule) {
+    uint32_t purged = 0;
+
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        CO_CANinterface_t* interface = &CANmodule->CANinterfaces[i];
+        struct CO_CANtxQueue* queue = interface->txQueue;
+        uint32_t purgedInterface = 0;
+
+        for (uint16_t index = 0; queue != NULL && index < CANmodule->txSize; index++) {
+            if (queue->position[index] != CO_CAN_TX_NOT_QUEUED && queue->entries[index].buffer.syncFlag) {
+                CO_CANtxQueueDrop(CANmodule, interface, index);
+                purgedInterface++;
+            }
+        }
+#if CO_DRIVER_TX_BATCH > 1
+        struct CO_CANtxBatch* batch = interface->txBatch;
+        uint32_t count = 0;
+
+        for (uint32_t j = 0; batch != NULL && j < batch->count; j++) {
+            if (batch->entries[j].buffer.syncFlag) {
+                CO_CANtxBatchDrop(CANmodule, interface, &batch->entries[j]);
+                purgedInterface++;
+                continue;
+            }
+            batch->entries[count] = batch->entries[j];
+            batch->iov[count].iov_len = batch->iov[j].iov_len;
+            batch->txtime[count] = batch->txtime[j];
+            count++;
+        }
+        if (batch != NULL) {
+            __atomic_store_n(&batch->count, count, __ATOMIC_RELAXED);
+        }
+#endif
 #if CO_DRIVER_ERROR_REPORTING > 0
-    CO_CANinterfaceState_t ifState;
+        if (purgedInterface > 0) {
+            interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_PDO_LATE;
+        } else {
+            interface->errorhandler.CANerrorStatus &= 0xFFFF ^ CO_CAN_ERRTX_PDO_LATE;
+        }
 #endif
-    ssize_t n;
-
-    if (CANmodule == NULL || interface == NULL || interface->fd < 0) {
-        return CO_ERROR_ILLEGAL_ARGUMENT;
+        purged += purgedInterface;
     }
-
-#if CO_DRIVER_ERROR_REPORTING > 0
-    ifState = CO_CANerror_txMsg(&interface->errorhandler);
-    switch (ifState) {
-        case CO_INTERFACE_ACTIVE:
-            /* continue */
-            break;
-        case CO_INTERFACE_LISTEN_ONLY:
-            /* silently drop message */
-            return CO_ERROR_NO;
-        default: return CO_ERROR_INVALID_STATE;
+#if CO_DRIVER_ERROR_REPORTING == 0
+    if (purged > 0) {
+        (void)__atomic_or_fetch(&CANmodule->txErrorStatus, CO_CAN_ERRTX_PDO_LATE, __ATOMIC_RELAXED);
+    } else {
+        (void)__atomic_and_fetch(&CANmodule->txErrorStatus, 0xFFFF ^ CO_CAN_ERRTX_PDO_LATE, __ATOMIC_RELAXED);
     }
 #endif
+    __atomic_store_n(&CANmodule->txSyncPurged, CANmodule->txSyncPurged + purged, __ATOMIC_RELAXED);
+}
 
-    do {
-        errno = 0;
-        n = send(interface->fd, buffer, CAN_MTU, MSG_DONTWAIT);
-        if (errno == EINTR) {
-            /* try again */
-            continue;
-        } else if (errno == EAGAIN) {
-            /* socket queue full */
-            break;
-        } else if (errno == ENOBUFS) {
-            /* socketCAN doesn't support blocking write. You can wait here for
-             * a few hundred us and then try again */
-#if CO_DRIVER_ERROR_REPORTING > 0
-            interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_OVERFLOW;
+/* Re-send unsent messages of the interface in priority order, until socket is full again, tx consumer only. Messages,
+ * deferred by tx shaper, return to the queue and do not block messages of other traffic classes. Disarm EPOLLOUT, if
+ * nothing is left. */
+static void
+CO_CANtxRetry(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface) {
+    struct CO_CANtxQueue* queue = interface->txQueue;
+    uint16_t count = queue->count;
+    uint16_t pass[count > 0 ? count : 1];
+    bool_t busy = false;
+    bool_t pending;
+
+#if CO_DRIVER_TX_BATCH > 1
+    (void)CO_CANtxBatchWrite(CANmodule, interface);
 #endif
-            return CO_ERROR_TX_BUSY;
-        } else if (n != CAN_MTU) {
-            break;
-        }
-    } while (errno != 0);
+    /* copies stay counted as pending, so bufferFull does not drop in between */
+    for (uint16_t i = 0; i < count; i++) {
+        pass[i] = queue->heap[0];
+        (void)CO_CANtxQueueTake(interface, pass[i]);
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        struct CO_CANtxEntry entry = queue->entries[pass[i]];
 
-    if (n != CAN_MTU) {
-#if CO_DRIVER_ERROR_REPORTING > 0
-        interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_OVERFLOW;
+        if (busy) {
+            CO_CANtxQueuePut(CANmodule, interface, &entry);
+        } else if (CO_CANsendInterface(CANmodule, interface, &entry, true) == CO_ERROR_TX_BUSY) {
+            busy = true;
+        }
+        CO_CANtxPendingAdd(CANmodule, pass[i], -1);
+    }
+#if CO_DRIVER_TX_BATCH > 1
+    pending = CO_CANtxBatchWrite(CANmodule, interface) > 0 || queue->count > 0;
+#else
+    pending = queue->count > 0;
 #endif
-        log_printf(LOG_ERR, DBG_CAN_TX_FAILED, buffer->ident, interface->ifName);
-        log_printf(LOG_DEBUG, DBG_ERRNO, "send()");
-        err = CO_ERROR_TX_OVERFLOW;
+    if (!pending) {
+        CO_CANtxWaitSet(CANmodule, interface, false);
     }
-
-    return err;
 }
 
-/*
- * The same as #CO_CANsend(), but ensures that there is enough space remaining
- * in the driver for more important messages.
- *
- * The default threshold is 50%, or at least 1 message buffer. If sending
- * would violate those limits, #CO_ERROR_TX_OVERFLOW is returned and the
- * message will not be sent.
- *
- * (It is not in header, because usage of CO_CANCheckSend() is unclear.)
- *
- * @param CANmodule This object.
- * @param buffer Pointer to transmit buffer, returned by CO_CANtxBufferInit().
- * Data bytes must be written in buffer before function call.
- *
- * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_TX_OVERFLOW, CO_ERROR_TX_BUSY or
- * CO_ERROR_TX_PDO_WINDOW (Synchronous TPDO is outside window).
- */
-CO_ReturnError_t CO_CANCheckSend(CO_CANmodule_t* CANmodule, CO_CANtx_t* buffer);
+#ifndef CO_SINGLE_THREAD
+/* Send messages from rings of other threads in order, tx consumer only. Return CO_CAN_TX_REQ_* bits, requested by
+ * other threads. */
+static uint32_t
+CO_CANtxRingDrain(CO_CANmodule_t* CANmodule) {
+    uint32_t request;
 
-CO_ReturnError_t
-CO_CANsend(CO_CANmodule_t* CANmodule, CO_CANtx_t* buffer) {
-    CO_ReturnError_t err;
-    err = CO_CANCheckSend(CANmodule, buffer);
-    if (err == CO_ERROR_TX_BUSY) {
-        /* send doesn't have "busy" */
-        log_printf(LOG_ERR, DBG_CAN_TX_FAILED, buffer->ident, "CANx");
-        log_printf(LOG_DEBUG, DBG_ERRNO, "send()");
-        err = CO_ERROR_TX_OVERFLOW;
+    if (CANmodule->txRings == NULL) {
+        return 0;
     }
-    return err;
-}
-
-CO_ReturnError_t
-CO_CANCheckSend(CO_CANmodule_t* CANmodule, CO_CANtx_t* buffer) {
-    uint32_t i;
-    CO_ReturnError_t err = CO_ERROR_NO;
 
-    /* check on which interfaces to send this messages */
-    for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
-        CO_CANinterface_t* interface = &CANmodule->CANinterfaces[i];
+    /* Next CO_CANtxKick() writes eventfd again. Exchange also makes everything pushed before the last kick visible. */
+    (void)__atomic_exchange_n(&CANmodule->txKick, false, __ATOMIC_SEQ_CST);
+    request = __atomic_exchange_n(&CANmodule->txRequest, 0U, __ATOMIC_ACQUIRE);
 
-        if ((buffer->can_ifindex == 0) || buffer->can_ifindex == interface->can_ifindex) {
+    for (uint32_t i = 0; i < CO_DRIVER_TX_PRODUCERS; i++) {
+        struct CO_CANtxRing* ring = &CANmodule->txRings[i];
+        uint32_t head = ring->head;
+        uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
 
-            CO_ReturnError_t tmp;
+        for (; head != tail; head++) {
+            const struct CO_CANtxEntry* entry = &ring->entries[head % CO_DRIVER_TX_RING];
 
-            /* match, use this one */
-            tmp = CO_CANCheckSendInterface(CANmodule, buffer, interface);
-            if (tmp) {
-                /* only last error is returned to callee */
-                err = tmp;
-            }
+            /* errors are indicated in CANerrorStatus */
+            (void)CO_CANtxSend(CANmodule, entry);
+            CO_CANtxPendingAdd(CANmodule, entry->index, -1);
+            __atomic_store_n(&ring->head, head + 1U, __ATOMIC_RELEASE);
         }
     }
-
-    return err;
+    return request;
 }
+#endif
 
-#warning CO_CANsend() is outdated for CO_DRIVER_MULTI_INTERFACE > 0
+/* Do requested tx work, tx consumer only. Request is a bit mask of CO_CAN_TX_REQ_*. Messages and requests from other
+ * threads are taken first. */
+static void
+CO_CANtxProcess(CO_CANmodule_t* CANmodule, uint32_t request) {
+#ifndef CO_SINGLE_THREAD
+    request |= CO_CANtxRingDrain(CANmodule);
+#endif
 
-#endif /* CO_DRIVER_MULTI_INTERFACE > 0 */
+    /* messages from previous SYNC window, still in the driver */
+    if ((request & CO_CAN_TX_REQ_PURGE) != 0U) {
+        CO_CANtxPurgeSync(CANmodule);
+    }
+    if ((request & CO_CAN_TX_REQ_RETRY) != 0U) {
+        /* deferred messages set it again */
+        __atomic_store_n(&CANmodule->txShaperNext_ns, 0, __ATOMIC_RELAXED);
+        for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+            CO_CANtxRetry(CANmodule, &CANmodule->CANinterfaces[i]);
+        }
+    }
+#if CO_DRIVER_TX_BATCH > 1
+    if ((request & CO_CAN_TX_REQ_FLUSH) != 0U) {
+        for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+            (void)CO_CANtxBatchWrite(CANmodule, &CANmodule->CANinterfaces[i]);
+        }
+    }
+#endif
+}
 
-#if CO_DRIVER_MULTI_INTERFACE == 0
+/* Do tx work in the tx consumer: immediately, if called from it, otherwise the consumer is woken up */
+static void
+CO_CANtxRequest(CO_CANmodule_t* CANmodule, uint32_t request) {
+#ifndef CO_SINGLE_THREAD
+    if (!CO_CANtxIsConsumer(CANmodule)) {
+        if (CANmodule->txRings != NULL) {
+            (void)__atomic_or_fetch(&CANmodule->txRequest, request, __ATOMIC_RELEASE);
+            CO_CANtxKick(CANmodule);
+        }
+        return;
+    }
+#endif
+    CO_CANtxProcess(CANmodule, request);
+}
 
-/* Change handling of tx buffer full in CO_CANsend(). Use CO_CANtx_t->bufferFull
- * flag. Re-transmit undelivered message inside CO_CANmodule_process(). */
+/* Change handling of tx buffer full in CO_CANsend(). Use CO_CANtx_t->bufferFull flag. Message is copied, so buffer may
+ * be changed after return. The tx consumer writes the copy immediately or queues it on each interface separately for
+ * re-transmission in CAN priority order. Other threads pass the copy to the consumer without waiting. */
 CO_ReturnError_t
 CO_CANsend(CO_CANmodule_t* CANmodule, CO_CANtx_t* buffer) {
-    CO_ReturnError_t err = CO_ERROR_NO;
+    struct CO_CANtxEntry entry;
 
-    if (CANmodule == NULL || buffer == NULL || CANmodule->CANinterfaceCount == 0) {
+    if (CANmodule == NULL || buffer == NULL || CANmodule->CANinterfaceCount == 0
+        || (size_t)(buffer - CANmodule->txArray) >= CANmodule->txSize) {
         return CO_ERROR_ILLEGAL_ARGUMENT;
     }
 
-    CO_CANinterface_t* interface = &CANmodule->CANinterfaces[0];
-    if (interface == NULL || interface->fd < 0) {
-        return CO_ERROR_ILLEGAL_ARGUMENT;
+    memcpy(&entry.buffer, buffer, (size_t)CO_CANtxMtu(buffer));
+    entry.buffer.bufferFull = false;
+    entry.buffer.syncFlag = buffer->syncFlag;
+    entry.buffer.can_ifindex = buffer->can_ifindex;
+    entry.index = (uint16_t)(buffer - CANmodule->txArray);
+    entry.send_ns = 0;
+    if (CANmodule->txStamps != NULL) {
+        /* start of tx latency, also for messages, which are re-sent later */
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        entry.send_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    }
+    if (CANmodule->txTimeOffset_us > 0 && buffer->ident == CANmodule->txTimeSyncIdent) {
+        /* SYNC producer, synchronous messages are launched relative to this time */
+        int64_t monoToTai_ns;
+        __atomic_store_n(&CANmodule->txTimeSync_ns, CO_CANtxTimeNow(&monoToTai_ns), __ATOMIC_RELAXED);
     }
 
-    /* Verify overflow */
-    if (buffer->bufferFull) {
-#if CO_DRIVER_ERROR_REPORTING > 0
-        interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_OVERFLOW;
-#endif
-        log_printf(LOG_ERR, DBG_CAN_TX_FAILED, buffer->ident, interface->ifName);
-        err = CO_ERROR_TX_OVERFLOW;
+#ifndef CO_SINGLE_THREAD
+    if (!CO_CANtxIsConsumer(CANmodule)) {
+        /* Socket errors are indicated in CANerrorStatus. TX_BUSY, if previous copy still waits in the driver. */
+        bool_t busy = __atomic_load_n(&CANmodule->txPending[entry.index], __ATOMIC_RELAXED) > 0;
+        CO_ReturnError_t err = CO_CANtxRingPush(CANmodule, &entry);
+        return (err == CO_ERROR_NO && busy) ? CO_ERROR_TX_BUSY : err;
     }
+#endif
+    return CO_CANtxSend(CANmodule, &entry);
+}
 
-    errno = 0;
-    ssize_t n = send(interface->fd, buffer, CAN_MTU, MSG_DONTWAIT);
-    if (errno == 0 && n == CAN_MTU) {
-        /* success */
-        if (buffer->bufferFull) {
-            buffer->bufferFull = false;
-            CANmodule->CANtxCount--;
+uint32_t
+CO_CANmodule_txFlush(CO_CANmodule_t* CANmodule) {
+    uint32_t pending = 0;
+
+    if (CANmodule == NULL) {
+        return 0;
+    }
+    if (CO_CANtxIsConsumer(CANmodule)) {
+        uint32_t request = 0;
+#if CO_DRIVER_TX_BATCH > 1
+        request |= CO_CAN_TX_REQ_FLUSH;
+#endif
+        if (CO_CANmodule_txShaperNext_us(CANmodule) == 0) {
+            /* deferred messages have credit now */
+            request |= CO_CAN_TX_REQ_RETRY;
         }
-    } else if (errno == EINTR || errno == EAGAIN || errno == ENOBUFS) {
-        /* Send failed, message will be re-sent by CO_CANmodule_process() */
-        if (!buffer->bufferFull) {
-            buffer->bufferFull = true;
-            CANmodule->CANtxCount++;
+        CO_CANtxProcess(CANmodule, request);
+    }
+#if CO_DRIVER_TX_BATCH > 1
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        if (CANmodule->CANinterfaces[i].txBatch != NULL) {
+            pending += __atomic_load_n(&CANmodule->CANinterfaces[i].txBatch->count, __ATOMIC_RELAXED);
         }
-        err = CO_ERROR_TX_BUSY;
-    } else {
-        /* Unknown error */
-        log_printf(LOG_DEBUG, DBG_ERRNO, "send()");
-#if CO_DRIVER_ERROR_REPORTING > 0
-        interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_OVERFLOW;
-#endif
-        err = CO_ERROR_SYSCALL;
     }
+#endif
+    return pending;
+}
 
-    return err;
+uint32_t
+CO_CANmodule_txShaperNext_us(CO_CANmodule_t* CANmodule) {
+    int64_t next_ns;
+    int64_t wait_ns;
+
+    if (CANmodule == NULL) {
+        return UINT32_MAX;
+    }
+    next_ns = __atomic_load_n(&CANmodule->txShaperNext_ns, __ATOMIC_RELAXED);
+    if (next_ns == 0) {
+        return UINT32_MAX;
+    }
+    wait_ns = next_ns - CO_CANtxClockNow();
+    if (wait_ns <= 0) {
+        return 0;
+    }
+    return (wait_ns >= (int64_t)UINT32_MAX * 1000) ? UINT32_MAX - 1U : (uint32_t)((wait_ns + 999) / 1000);
 }
 
-#endif /* CO_DRIVER_MULTI_INTERFACE == 0 */
+void
+CO_CANmodule_txConsumer(CO_CANmodule_t* CANmodule) {
+#ifndef CO_SINGLE_THREAD
+    if (CANmodule != NULL && !CO_CANtxIsConsumer(CANmodule)) {
+        CANmodule->txConsumer = pthread_self();
+        __atomic_store_n(&CANmodule->txConsumerSet, true, __ATOMIC_RELEASE);
+    }
+#else
+    (void)CANmodule;
+#endif
+}
 
 void
 CO_CANclearPendingSyncPDOs(CO_CANmodule_t* CANmodule) {
-    (void)CANmodule;
-    /* Messages are either written to the socket queue or dropped */
+    /* Synchronous messages, which are still in the driver, are outside of SYNC window now. Messages already written to
+     * the socket can not be removed. */
+    if (CANmodule != NULL && CANmodule->CANinterfaceCount > 0) {
+        CO_CANtxRequest(CANmodule, CO_CAN_TX_REQ_PURGE);
+    }
 }
 
 void
@@ -691,48 +2769,249 @@ CO_CANmodule_process(CO_CANmodule_t* CANmodule) {
      * error has occured, a special can message is created by the driver and
      * received by the application like a regular message.
      * Therefore, error counter evaluation is included in rx function.
-     * Here we just copy evaluated CANerrorStatus from the first CAN interface. */
+     * Here we combine evaluated CANerrorStatus from all CAN interfaces. */
 
-    CANmodule->CANerrorStatus = CANmodule->CANinterfaces[0].errorhandler.CANerrorStatus;
+    CANmodule->CANerrorStatus = 0;
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        CANmodule->CANerrorStatus |= CANmodule->CANinterfaces[i].errorhandler.CANerrorStatus;
+    }
+#else
+    /* CO_CAN_ERRTX_PDO_LATE is set again from txErrorStatus, while it is indicated */
+    CANmodule->CANerrorStatus &= 0xFFFF ^ (CO_CAN_ERRRX_OVERFLOW | CO_CAN_ERRTX_PDO_LATE);
 #endif
+    /* tx errors from threads, which do not own the interface error status */
+    CANmodule->CANerrorStatus |= __atomic_load_n(&CANmodule->txErrorStatus, __ATOMIC_RELAXED);
 
-#if CO_DRIVER_MULTI_INTERFACE == 0
-    /* recall CO_CANsend(), if message was unsent before */
-    if (CANmodule->CANtxCount > 0) {
-        bool_t found = false;
-
-        for (uint16_t i = 0; i < CANmodule->txSize; i++) {
-            CO_CANtx_t* buffer = &CANmodule->txArray[i];
-
-            if (buffer->bufferFull) {
-                buffer->bufferFull = false;
-                CANmodule->CANtxCount--;
-                CO_CANsend(CANmodule, buffer);
-                found = true;
-                break;
+    /* install rx filters changed since last call, outside of configuration transaction */
+    if (CANmodule->rxFilterDirty && CANmodule->rxFilterHold == 0 && CANmodule->CANnormal) {
+        (void)setRxFilters(CANmodule);
+    }
+
+    /* Rx overflow is also indicated, while too many messages are dropped on any socket rx queue */
+    {
+        CO_CANrxDropStats_t stats;
+        if (CO_CANmodule_getRxDrops(CANmodule, 0, &stats) && stats.alarm) {
+            CANmodule->CANerrorStatus |= CO_CAN_ERRRX_OVERFLOW;
+        }
+    }
+
+    /* unsent messages are normally sent, when socket becomes writable, this is fallback */
+    if (__atomic_load_n(&CANmodule->CANtxCount, __ATOMIC_RELAXED) > 0) {
+        CO_CANtxRequest(CANmodule, CO_CAN_TX_REQ_RETRY);
+    }
+}
+
+/* Sample clocks, needed for CO_CANtimestampConvert(), once after reading from socket */
+static void
+CO_CANclockSample(CO_CANclockSample_t* clk) {
+    struct timespec real, mono;
+
+    clock_gettime(CLOCK_REALTIME, &real);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clk->mono_ns = (int64_t)mono.tv_sec * 1000000000LL + mono.tv_nsec;
+    clk->realToMono_ns = clk->mono_ns - ((int64_t)real.tv_sec * 1000000000LL + real.tv_nsec);
+}
+
+/* Convert timestamp from SO_TIMESTAMPING ancillary data into CLOCK_MONOTONIC. Software (ts[0]) and synchronized
+ * hardware timestamps are in CLOCK_REALTIME, so they are shifted by current offset, which makes them immune to steps of
+ * the system clock. Free running hardware clock (ts[2]) has unknown offset. Message is always timestamped before it is
+ * read, so offset is estimated as the minimum difference between read time and hardware timestamp within the window. */
+static void
+CO_CANtimestampConvert(CO_CANinterface_t* interface, const struct scm_timestamping* tss, const CO_CANclockSample_t* clk,
+                       struct timespec* timestamp) {
+    const struct timespec* hw = &tss->ts[2];
+    int64_t ts_ns;
+
+    if (interface->timestamp == CO_CAN_TIMESTAMP_SW || (hw->tv_sec == 0 && hw->tv_nsec == 0)) {
+        ts_ns = (int64_t)tss->ts[0].tv_sec * 1000000000LL + tss->ts[0].tv_nsec + clk->realToMono_ns;
+    } else if (interface->timestamp == CO_CAN_TIMESTAMP_HW) {
+        ts_ns = (int64_t)hw->tv_sec * 1000000000LL + hw->tv_nsec + clk->realToMono_ns;
+    } else {
+        int64_t hw_ns = (int64_t)hw->tv_sec * 1000000000LL + hw->tv_nsec;
+        int64_t offset_ns = clk->mono_ns - hw_ns;
+
+        if (offset_ns < interface->tsOffsetMin_ns) {
+            interface->tsOffsetMin_ns = offset_ns;
+        }
+        if (interface->tsWindowStart_ns == 0 || offset_ns < interface->tsOffset_ns) {
+            /* first message or hardware clock runs faster */
+            interface->tsOffset_ns = offset_ns;
+        }
+        if (interface->tsWindowStart_ns == 0
+            || (clk->mono_ns - interface->tsWindowStart_ns) > CO_CAN_TIMESTAMP_WINDOW_NS) {
+            /* follow also slower hardware clock */
+            interface->tsOffset_ns = interface->tsOffsetMin_ns;
+            interface->tsOffsetMin_ns = INT64_MAX;
+            interface->tsWindowStart_ns = clk->mono_ns;
+        }
+        ts_ns = hw_ns + interface->tsOffset_ns;
+    }
+
+    /* message can not be received in the future */
+    if (ts_ns > clk->mono_ns) {
+        ts_ns = clk->mono_ns;
+    }
+    timestamp->tv_sec = ts_ns / 1000000000LL;
+    timestamp->tv_nsec = ts_ns % 1000000000LL;
+}
+
+/* Evaluate ancillary data of received CAN message: get rx time and check for rx queue overflow */
+static void
+CO_CANreadCmsg(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, struct msghdr* msghdr,
+               const CO_CANclockSample_t* clk, struct timespec* timestamp) {
+    struct cmsghdr* cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(msghdr); cmsg && (cmsg->cmsg_level == SOL_SOCKET); cmsg = CMSG_NXTHDR(msghdr, cmsg)) {
+        if (cmsg->cmsg_type == SO_TIMESTAMPING) {
+            CO_CANtimestampConvert(interface, (struct scm_timestamping*)CMSG_DATA(cmsg), clk, timestamp);
+        } else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+            uint32_t dropped = *(uint32_t*)CMSG_DATA(cmsg);
+            if (dropped != interface->rxDropCount) {
+                uint32_t count = dropped - interface->rxDropCount;
+
+                CO_CANrxDropAdd(interface, (uint32_t)(clk->mono_ns / 1000000000LL), count);
+                CANmodule->rxDropCount += count;
+                interface->rxDropCount = dropped;
+                log_printf(LOG_ERR, CAN_RX_SOCKET_QUEUE_OVERFLOW, interface->ifName, dropped);
+
+                /* adaptive rx buffer size. Kernel reports doubled value of the requested size, so requesting the
+                 * reported size doubles the buffer. */
+                if ((interface->rxBufferSize / 2) < interface->rxBufferSizeMax) {
+                    int bytes = interface->rxBufferSize;
+                    if (bytes > interface->rxBufferSizeMax) {
+                        bytes = interface->rxBufferSizeMax;
+                    }
+                    (void)CO_CANsetRxBuffer(interface, bytes);
+                }
+            }
+        }
+    }
+}
+
+/* Add one measured latency to the statistics of the identifier, stamps are locked */
+static void
+CO_CANtxLatencyAdd(struct CO_CANtxStamps* stamps, uint32_t ident, int64_t latency_ns) {
+    uint16_t ident11 = (uint16_t)(ident & CAN_SFF_MASK);
+    int64_t us = latency_ns / 1000;
+    uint32_t latency_us = (us < 0) ? 0 : ((us > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)us);
+    CO_CANtxLatency_t* latency;
+    uint32_t bucket = 0;
+
+    if (stamps->slot[ident11] == CO_CAN_TX_STAMP_NONE) {
+        if (stamps->count >= stamps->size) {
+            /* more identifiers than tx buffers, ignore */
+            return;
+        }
+        stamps->slot[ident11] = stamps->count;
+        latency = &stamps->latency[stamps->count++];
+        latency->ident = ident11;
+        latency->min_us = UINT32_MAX;
+    }
+    latency = &stamps->latency[stamps->slot[ident11]];
+
+    latency->count++;
+    latency->sum_us += latency_us;
+    if (latency_us < latency->min_us) {
+        latency->min_us = latency_us;
+    }
+    if (latency_us > latency->max_us) {
+        latency->max_us = latency_us;
+    }
+    for (uint32_t v = latency_us; v > 1U && bucket < (CO_CAN_TX_LATENCY_BUCKETS - 1U); v >>= 1) {
+        bucket++;
+    }
+    latency->histogram[bucket]++;
+}
+
+/* Read tx timestamps from socket error queue and match them with sent messages. Kernel returns copy of each sent
+ * message with SO_TIMESTAMPING data. Messages without timestamp in the FIFO are skipped, so lost timestamps do not
+ * shift the matching. Return true, if anything was read. */
+static bool_t
+CO_CANtxStampRead(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface) {
+    struct CO_CANtxStampFifo* fifo = interface->txStampFifo;
+    bool_t read = false;
+
+    for (;;) {
+        CO_CANframe_t msg;
+        struct iovec iov = {.iov_base = &msg, .iov_len = sizeof(msg)};
+        char ctrlmsg[CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(struct sock_extended_err))];
+        struct msghdr msghdr = {0};
+        const struct scm_timestamping* tss = NULL;
+        struct cmsghdr* cmsg;
+        CO_CANclockSample_t clk;
+        struct timespec timestamp;
+
+        msghdr.msg_iov = &iov;
+        msghdr.msg_iovlen = 1;
+        msghdr.msg_control = ctrlmsg;
+        msghdr.msg_controllen = sizeof(ctrlmsg);
+        if (!CO_CANrxMtuValid(recvmsg(interface->fd, &msghdr, MSG_ERRQUEUE | MSG_DONTWAIT))) {
+            break;
+        }
+        read = true;
+
+        /* error queue has also sock_extended_err from SOL_CAN_RAW level, which is not used */
+        for (cmsg = CMSG_FIRSTHDR(&msghdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&msghdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPING) {
+                tss = (const struct scm_timestamping*)CMSG_DATA(cmsg);
             }
         }
+        if (tss == NULL || (tss->ts[0].tv_sec == 0 && tss->ts[0].tv_nsec == 0 && tss->ts[2].tv_sec == 0
+                            && tss->ts[2].tv_nsec == 0)) {
+            continue;
+        }
+        CO_CANclockSample(&clk);
+        CO_CANtimestampConvert(interface, tss, &clk, &timestamp);
+
+        /* FIFO is filled by the tx consumer, which also reads the error queue */
+        for (uint32_t i = 0; i < fifo->count; i++) {
+            uint32_t pos = (fifo->head + i) % CO_CAN_TX_STAMP_FIFO;
+
+            if (fifo->entries[pos].ident == msg.can_id) {
+                int64_t ts_ns = (int64_t)timestamp.tv_sec * 1000000000LL + timestamp.tv_nsec;
 
-        if (!found) {
-            CANmodule->CANtxCount = 0;
+                CO_CANtxStampLock(CANmodule);
+                CO_CANtxLatencyAdd(CANmodule->txStamps, msg.can_id, ts_ns - fifo->entries[pos].send_ns);
+                CO_CANtxStampUnlock(CANmodule);
+                fifo->head = (pos + 1U) % CO_CAN_TX_STAMP_FIFO;
+                fifo->count -= i + 1U;
+                break;
+            }
         }
     }
-#endif /* CO_DRIVER_MULTI_INTERFACE == 0 */
+
+    return read;
+}
+
+bool_t
+CO_CANmodule_getTxLatency(CO_CANmodule_t* CANmodule, uint16_t n, CO_CANtxLatency_t* latency) {
+    bool_t ret = false;
+
+    if (CANmodule == NULL || latency == NULL || CANmodule->txStamps == NULL) {
+        return false;
+    }
+    CO_CANtxStampLock(CANmodule);
+    if (n < CANmodule->txStamps->count) {
+        *latency = CANmodule->txStamps->latency[n];
+        ret = true;
+    }
+    CO_CANtxStampUnlock(CANmodule);
+    return ret;
 }
 
-/* Read CAN message from socket and verify some errors */
+#if CO_DRIVER_RX_BATCH <= 1
+/* Read CAN message from socket and verify some errors. Return CO_ERROR_TIMEOUT, if socket is empty. */
 static CO_ReturnError_t
 CO_CANread(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface,
-           struct can_frame* msg,      /* CAN message, return value */
+           CO_CANframe_t* msg,         /* CAN message, return value */
            struct timespec* timestamp) /* timestamp of CAN message, return value */
 {
     int32_t n;
-    uint32_t dropped;
     /* recvmsg - like read, but generates statistics about the socket example in berlios candump.c */
     struct iovec iov;
     struct msghdr msghdr;
-    char ctrlmsg[CMSG_SPACE(sizeof(struct timeval)) + CMSG_SPACE(sizeof(dropped))];
-    struct cmsghdr* cmsg;
+    char ctrlmsg[CO_CAN_CTRLMSG_SIZE];
+    CO_CANclockSample_t clk;
 
     iov.iov_base = msg;
     iov.iov_len = sizeof(*msg);
@@ -745,8 +3024,11 @@ CO_CANread(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface,
     msghdr.msg_controllen = sizeof(ctrlmsg);
     msghdr.msg_flags = 0;
 
-    n = recvmsg(interface->fd, &msghdr, 0);
-    if (n != CAN_MTU) {
+    n = recvmsg(interface->fd, &msghdr, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return CO_ERROR_TIMEOUT;
+    }
+    if (!CO_CANrxMtuValid(n)) {
 #if CO_DRIVER_ERROR_REPORTING > 0
         interface->errorhandler.CANerrorStatus |= CO_CAN_ERRRX_OVERFLOW;
 #endif
@@ -754,124 +3036,225 @@ CO_CANread(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface,
         log_printf(LOG_DEBUG, DBG_ERRNO, "recvmsg()");
         return CO_ERROR_SYSCALL;
     }
+    CO_CANrxSetFdFlag(msg, n);
 
     /* check for rx queue overflow, get rx time */
-    for (cmsg = CMSG_FIRSTHDR(&msghdr); cmsg && (cmsg->cmsg_level == SOL_SOCKET); cmsg = CMSG_NXTHDR(&msghdr, cmsg)) {
-        if (cmsg->cmsg_type == SO_TIMESTAMPING) {
-            /* this is system time, not monotonic time! */
-            *timestamp = ((struct timespec*)CMSG_DATA(cmsg))[0];
-        } else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
-            dropped = *(uint32_t*)CMSG_DATA(cmsg);
-            if (dropped > CANmodule->rxDropCount) {
+    CO_CANclockSample(&clk);
+    CO_CANreadCmsg(CANmodule, interface, &msghdr, &clk, timestamp);
+
+    return CO_ERROR_NO;
+}
+
+#else
+/* Read up to count (max CO_DRIVER_RX_BATCH) CAN messages from socket with single system call into CANmodule->rxBatch.
+ * Return number of messages read, 0 if socket is empty or -1 on error. */
+static int
+CO_CANreadBatch(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, unsigned int count) {
+    struct CO_CANrxBatch* batch = CANmodule->rxBatch;
+    int n;
+
+    /* recvmmsg modifies length of ancillary data, restore it */
+    for (unsigned int i = 0; i < count; i++) {
+        batch->msgs[i].msg_hdr.msg_controllen = CO_CAN_CTRLMSG_SIZE;
+        batch->msgs[i].msg_hdr.msg_flags = 0;
+    }
+
+    n = recvmmsg(interface->fd, batch->msgs, count, MSG_DONTWAIT, NULL);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return 0;
+    }
+    if (n <= 0) {
 #if CO_DRIVER_ERROR_REPORTING > 0
-                interface->errorhandler.CANerrorStatus |= CO_CAN_ERRRX_OVERFLOW;
+        interface->errorhandler.CANerrorStatus |= CO_CAN_ERRRX_OVERFLOW;
 #endif
-                log_printf(LOG_ERR, CAN_RX_SOCKET_QUEUE_OVERFLOW, interface->ifName, dropped);
-            }
-            CANmodule->rxDropCount = dropped;
-            // todo use this info!
-        }
+        log_printf(LOG_DEBUG, DBG_CAN_RX_FAILED, interface->ifName);
+        log_printf(LOG_DEBUG, DBG_ERRNO, "recvmmsg()");
+        return -1;
     }
 
-    return CO_ERROR_NO;
+    return n;
 }
+#endif /* CO_DRIVER_RX_BATCH > 1 */
 
 /* find msg inside rxArray and call corresponding CANrx_callback */
 static int32_t
-CO_CANrxMsg(                                                  /* return index of received message in rxArray or -1 */
-            CO_CANmodule_t* CANmodule, struct can_frame* msg, /* CAN message input */
+CO_CANrxMsg(                                                  /* return index of received message (see below) or -1 */
+            CO_CANmodule_t* CANmodule, CO_CANframe_t* msg,    /* CAN message input */
             CO_CANrxMsg_t* buffer)                            /* If not NULL, msg will be copied to buffer */
 {
-    int32_t retval;
-    const CO_CANrxMsg_t* rcvMsg;  /* pointer to received message in CAN module */
-    uint16_t index;               /* index of received message */
-    CO_CANrx_t* rcvMsgObj = NULL; /* receive message object from CO_CANmodule_t object. */
-    bool_t msgMatched = false;
+    const CO_CANrxMsg_t* rcvMsg; /* pointer to received message in CAN module */
+    int32_t index;               /* index of received message */
+    CO_CANrx_t* rcvMsgObj;       /* receive message object from CO_CANmodule_t object. */
 
     /* CANopenNode can message is binary compatible to the socketCAN one, including the extension flags */
     // msg->can_id &= CAN_EFF_MASK;
     rcvMsg = (CO_CANrxMsg_t*)msg;
 
-    /* Message has been received. Search rxArray from CANmodule for the
-     * same CAN-ID. */
-    rcvMsgObj = &CANmodule->rxArray[0];
-    for (index = 0; index < CANmodule->rxSize; index++) {
-        if (((rcvMsg->ident ^ rcvMsgObj->ident) & rcvMsgObj->mask) == 0U) {
-            msgMatched = true;
-            break;
+    /* Message has been received. Find rx buffer for the same CAN-ID, cost does not depend on rxSize. Buffers for
+     * 29-bit identifiers are indexed after rxArray. */
+    if ((rcvMsg->ident & CAN_EFF_FLAG) != 0 && CANmodule->rxEffSize > 0) {
+        index = CO_CANrxEffLookup(CANmodule, rcvMsg->ident);
+        if (index == CO_CAN_RX_INDEX_NONE) {
+            return -1;
+        }
+        rcvMsgObj = &CANmodule->rxEffArray[index];
+        index += CANmodule->rxSize;
+    } else {
+        index = CO_CANrxLookup(CANmodule, rcvMsg->ident);
+        if (index == CO_CAN_RX_INDEX_NONE) {
+            return -1;
         }
-        rcvMsgObj++;
+        rcvMsgObj = &CANmodule->rxArray[index];
     }
-    if (msgMatched) {
-        /* Call specific function, which will process the message */
-        if ((rcvMsgObj != NULL) && (rcvMsgObj->CANrx_callback != NULL)) {
-            rcvMsgObj->CANrx_callback(rcvMsgObj->object, (void*)rcvMsg);
+
+    /* Call specific function, which will process the message */
+    if (rcvMsgObj->CANrx_callback != NULL) {
+        rcvMsgObj->CANrx_callback(rcvMsgObj->object, (void*)rcvMsg);
+    }
+    /* return message */
+    if (buffer != NULL) {
+        memcpy(buffer, rcvMsg, sizeof(*buffer));
+    }
+
+    return index;
+}
+
+/* Pre-process one received CAN message: evaluate CAN error message or dispatch data message to rxArray */
+static void
+CO_CANrxFrame(CO_CANmodule_t* CANmodule, CO_CANinterface_t* interface, CO_CANframe_t* msg,
+              const struct timespec* timestamp, CO_CANrxMsg_t* buffer, int32_t* msgIndex) {
+    if (msg->can_id & CAN_ERR_FLAG) {
+        /* error msg, always classical CAN frame */
+#if CO_DRIVER_ERROR_REPORTING > 0
+        CO_CANerror_rxMsgError(&interface->errorhandler, (const struct can_frame*)msg);
+#endif
+    } else {
+        /* data msg */
+#if CO_DRIVER_ERROR_REPORTING > 0
+        /* clear listenOnly and noackCounter if necessary */
+        CO_CANerror_rxMsg(&interface->errorhandler);
+#endif
+        int32_t idx = CO_CANrxMsg(CANmodule, msg, buffer);
+        if (idx > -1) {
+            /* Store message info */
+            CO_CANrx_t* rxBuffer = (idx < CANmodule->rxSize) ? &CANmodule->rxArray[idx]
+                                                              : &CANmodule->rxEffArray[idx - CANmodule->rxSize];
+            rxBuffer->timestamp = *timestamp;
+            rxBuffer->can_ifindex = interface->can_ifindex;
         }
-        /* return message */
-        if (buffer != NULL) {
-            memcpy(buffer, rcvMsg, sizeof(*buffer));
+        if (CANmodule->txTimeOffset_us > 0 && msg->can_id == CANmodule->txTimeSyncIdent) {
+            /* synchronous messages are launched relative to reception of SYNC */
+            int64_t sync_ns = (int64_t)timestamp->tv_sec * 1000000000LL + timestamp->tv_nsec;
+            __atomic_store_n(&CANmodule->txTimeSync_ns, sync_ns, __ATOMIC_RELAXED);
+        }
+        if (msgIndex != NULL) {
+            *msgIndex = idx;
         }
-        retval = index;
-    } else {
-        retval = -1;
     }
-
-    return retval;
 }
 
 bool_t
 CO_CANrxFromEpoll(CO_CANmodule_t* CANmodule, struct epoll_event* ev, CO_CANrxMsg_t* buffer, int32_t* msgIndex) {
+    const CO_epoll_handler_t* handler;
+    CO_CANinterface_t* interface;
+    uint32_t events;
+
     if (CANmodule == NULL || ev == NULL || CANmodule->CANinterfaceCount == 0) {
         return false;
     }
 
-    /* Verify for epoll events in CAN socket */
-    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
-        CO_CANinterface_t* interface = &CANmodule->CANinterfaces[i];
-
-        if (ev->data.fd == interface->fd) {
-            if ((ev->events & (EPOLLERR | EPOLLHUP)) != 0) {
-                struct can_frame msg;
-                /* epoll detected close/error on socket. Try to pull event */
-                errno = 0;
-                recv(ev->data.fd, &msg, sizeof(msg), MSG_DONTWAIT);
-                log_printf(LOG_DEBUG, DBG_CAN_RX_EPOLL, ev->events, strerror(errno));
-            } else if ((ev->events & EPOLLIN) != 0) {
-                struct can_frame msg;
-                struct timespec timestamp;
+    /* Event belongs to socket of this CANmodule, handler is inside the interface */
+    handler = (const CO_epoll_handler_t*)ev->data.ptr;
+    if (handler == NULL || handler->object != (void*)CANmodule) {
+        return false;
+    }
+#ifndef CO_SINGLE_THREAD
+    if (handler == &CANmodule->txEventHandler) {
+        /* other thread has passed messages or requests through CO_CANtxRequest() */
+        uint64_t u;
+        (void)read(CANmodule->txEventFd, &u, sizeof(u));
+        CO_CANtxProcess(CANmodule, CO_CAN_TX_REQ_FLUSH);
+        return true;
+    }
+#endif
+    if (handler->type == CO_EPOLL_HANDLER_CAN_TX) {
+        if ((ev->events & EPOLLOUT) != 0) {
+            CO_CANtxProcess(CANmodule, CO_CAN_TX_REQ_RETRY);
+        }
+        return true;
+    }
+    if (handler->type != CO_EPOLL_HANDLER_CAN_RX) {
+        return false;
+    }
+    interface = (CO_CANinterface_t*)((char*)handler - offsetof(CO_CANinterface_t, rxHandler));
+    events = ev->events;
 
-                /* get message */
-                CO_ReturnError_t err = CO_CANread(CANmodule, interface, &msg, &timestamp);
+    /* Pending tx timestamps also signal EPOLLERR */
+    if ((events & EPOLLERR) != 0 && interface->txStampFifo != NULL && CO_CANtxStampRead(CANmodule, interface)) {
+        events &= ~(uint32_t)EPOLLERR;
+        if (events == 0) {
+            return true;
+        }
+    }
+    if ((events & (EPOLLERR | EPOLLHUP)) != 0) {
+        struct can_frame msg;
+        /* epoll detected close/error on socket. Try to pull event */
+        errno = 0;
+        recv(interface->fd, &msg, sizeof(msg), MSG_DONTWAIT);
+        log_printf(LOG_DEBUG, DBG_CAN_RX_EPOLL, events, strerror(errno));
+    } else if ((events & EPOLLIN) != 0) {
+        /* read until socket is empty or budget is spent, process messages in between */
+        uint32_t budget = CO_DRIVER_RX_BUDGET;
+#if CO_DRIVER_RX_BATCH > 1
+        struct CO_CANrxBatch* batch = CANmodule->rxBatch;
+
+        /* budget counts batches */
+        do {
+            CO_CANclockSample_t clk;
+            const unsigned int count = CO_DRIVER_RX_BATCH;
+
+            /* get all available messages, up to count */
+            int n = CO_CANreadBatch(CANmodule, interface, count);
+            if (n <= 0) {
+                break;
+            }
+            CO_CANclockSample(&clk);
 
-                if (err == CO_ERROR_NO && CANmodule->CANnormal) {
+            /* dispatch them in one pass */
+            for (int j = 0; j < n; j++) {
+                struct timespec timestamp = {0};
 
-                    if (msg.can_id & CAN_ERR_FLAG) {
-                        /* error msg */
-#if CO_DRIVER_ERROR_REPORTING > 0
-                        CO_CANerror_rxMsgError(&interface->errorhandler, &msg);
-#endif
-                    } else {
-                        /* data msg */
-#if CO_DRIVER_ERROR_REPORTING > 0
-                        /* clear listenOnly and noackCounter if necessary */
-                        CO_CANerror_rxMsg(&interface->errorhandler);
-#endif
-                        int32_t idx = CO_CANrxMsg(CANmodule, &msg, buffer);
-                        if (idx > -1) {
-                            /* Store message info */
-                            CANmodule->rxArray[idx].timestamp = timestamp;
-                            CANmodule->rxArray[idx].can_ifindex = interface->can_ifindex;
-                        }
-                        if (msgIndex != NULL) {
-                            *msgIndex = idx;
-                        }
-                    }
+                if (!CO_CANrxMtuValid(batch->msgs[j].msg_len)) {
+                    log_printf(LOG_DEBUG, DBG_CAN_RX_FAILED, interface->ifName);
+                    continue;
+                }
+                CO_CANrxSetFdFlag(&batch->frames[j], batch->msgs[j].msg_len);
+                CO_CANreadCmsg(CANmodule, interface, &batch->msgs[j].msg_hdr, &clk, &timestamp);
+                if (CANmodule->CANnormal) {
+                    CO_CANrxFrame(CANmodule, interface, &batch->frames[j], &timestamp, buffer, msgIndex);
                 }
-            } else {
-                log_printf(LOG_DEBUG, DBG_EPOLL_UNKNOWN, ev->events, ev->data.fd);
             }
-            return true;
-        } /* if (ev->data.fd == interface->fd) */
+
+            /* socket is empty, if it returned less than requested */
+            budget = ((unsigned int)n < count) ? 0 : (budget - 1U);
+        } while (budget > 0);
+#else
+        do {
+            CO_CANframe_t msg;
+            struct timespec timestamp;
+
+            /* get message */
+            CO_ReturnError_t err = CO_CANread(CANmodule, interface, &msg, &timestamp);
+            if (err != CO_ERROR_NO) {
+                break;
+            }
+            if (CANmodule->CANnormal) {
+                CO_CANrxFrame(CANmodule, interface, &msg, &timestamp, buffer, msgIndex);
+            }
+        } while (--budget > 0);
+#endif
+    } else {
+        log_printf(LOG_DEBUG, DBG_EPOLL_UNKNOWN, events, interface->fd);
     }
-    return false;
+    return true;
 }
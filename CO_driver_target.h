@@ -187,6 +187,142 @@ ip link set canX type can berr-reporting on
 #define CO_DRIVER_ERROR_REPORTING 1
 #endif
 
+/**
+ * Batched CAN receive
+ *
+ * Maximum number of CAN messages, which are read from the socketCAN interface with single recvmmsg() system call inside
+ * CO_CANrxFromEpoll(). Messages are read into preallocated buffers, each with own timestamp and rx queue overflow
+ * information, and are then all dispatched to CANopenNode objects in one pass. This reduces number of system calls and
+ * epoll wakeups on busy CAN bus, for example after SYNC, when many PDOs are received at once.
+ *
+ * If CO_DRIVER_RX_BATCH is set to 1, then each CAN message is read with own recvmsg() system call.
+ *
+ * Macro is set to 1 (disabled) by default. It can be overridden, value 16 or 32 is reasonable.
+ */
+#ifndef CO_DRIVER_RX_BATCH
+#define CO_DRIVER_RX_BATCH 1
+#endif
+
+/**
+ * Batched CAN transmit
+ *
+ * If larger than 1, CO_CANsend() does not write the message to the socket immediately. Message is copied into tx
+ * staging queue of this size, which is written with single sendmmsg() system call by CO_CANmodule_txFlush(). Flush is
+ * called at the end of CO_epoll_processRT() and CO_epoll_processMain() and when the queue is full. So for example all
+ * TPDOs after SYNC are sent with one system call.
+ *
+ * If socket accepts only part of the queue, remaining messages stay queued in original order and are sent by next
+ * flush. If queue is still full, CO_CANsend() marks tx buffer as full and it is retried by CO_CANmodule_process(), as
+ * without batching. Staged message keeps its tx buffer marked as full and is counted in route load and tx latency
+ * statistics only after the socket accepts it.
+ *
+ * With CO_DRIVER_MULTI_INTERFACE each interface has own staging queue. Staging queues belong to the tx consumer, see
+ * @ref CO_DRIVER_TX_PRODUCERS, messages from other threads are staged and flushed by the consumer.
+ *
+ * Macro is set to 1 (disabled) by default. It can be overridden, value 32 or 64 is reasonable.
+ */
+#ifndef CO_DRIVER_TX_BATCH
+#define CO_DRIVER_TX_BATCH 1
+#endif
+
+/**
+ * Threads, which call CO_CANsend() besides the tx consumer
+ *
+ * Sockets and tx queues belong to single tx consumer thread, which calls CO_CANmodule_txConsumer(), normally the
+ * thread with CO_epoll_processRT(). CO_CANsend() from the consumer writes the message directly. Other threads copy the
+ * message into own single producer ring, each thread gets one ring on first use, and wake up the consumer with
+ * eventfd. No lock is shared between threads and no system call is made with message in hand, except eventfd write,
+ * when the consumer is idle.
+ *
+ * If all rings are taken by other threads, CO_CANsend() from next thread fails with CO_ERROR_TX_OVERFLOW.
+ *
+ * Macro is set to 2 (mainline and one more thread) by default. It is not used with CO_SINGLE_THREAD.
+ */
+#ifndef CO_DRIVER_TX_PRODUCERS
+#define CO_DRIVER_TX_PRODUCERS 2
+#endif
+
+/**
+ * Size of each ring for CAN messages from other threads to the tx consumer, see @ref CO_DRIVER_TX_PRODUCERS
+ *
+ * If ring is full, CO_CANsend() fails with CO_ERROR_TX_OVERFLOW and CO_CAN_ERRTX_OVERFLOW is indicated. It may happen,
+ * if the consumer does not run for long time, so size should cover messages sent by mainline during one cycle.
+ *
+ * Macro is set to 64 by default. It can be overridden, value must be power of two.
+ */
+#ifndef CO_DRIVER_TX_RING
+#define CO_DRIVER_TX_RING 64
+#endif
+
+/**
+ * CAN FD support
+ *
+ * If enabled, CAN_RAW_FD_FRAMES socket option is set on each interface. CO_CANrxMsg_t and CO_CANtx_t are then binary
+ * compatible with struct canfd_frame and carry up to 64 data bytes. Received classical and CAN FD messages are both
+ * dispatched to CANrx_callback, DLC contains data length and _flags_ contains CAN FD flags.
+ *
+ * Tx buffer, initialized by CO_CANtxBufferInit() with more than 8 bytes, is sent as CAN FD frame with bit rate switch
+ * (CANFD_FDF | CANFD_BRS in _flags_). Application may change _flags_, for example clear CANFD_BRS or set CANFD_FDF for
+ * short CAN FD frame. Other messages are sent as classical CAN frames.
+ *
+ * CAN interface must have MTU of 72 bytes, for example virtual CAN interface:
+ * @code{.sh}
+ip link set can0 mtu 72
+ * @endcode
+ *
+ * Macro is set to 0 (disabled) by default. It can be overridden.
+ */
+#ifndef CO_DRIVER_CANFD
+#define CO_DRIVER_CANFD 0
+#endif
+
+/**
+ * Rx frame budget
+ *
+ * Maximum number of CAN messages, which are read from one socketCAN interface inside single CO_CANrxFromEpoll() call.
+ * If @ref CO_DRIVER_RX_BATCH is larger than 1, budget counts recvmmsg() calls instead, each reads up to
+ * CO_DRIVER_RX_BATCH messages. Socket is read non-blocking until it is empty or budget is reached. So burst of messages
+ * is processed with single pass through CO_epoll_wait() and CO_epoll_processRT(), instead of paying full loop overhead
+ * for each message. Budget bounds the time spent in reception, remaining messages are read after next epoll_wait().
+ *
+ * If CO_CANrxFromEpoll() is used in manual mode (_buffer_ and _msgIndex_ arguments), only the last received message is
+ * returned, so budget should be 1 in that case.
+ *
+ * Macro is set to 1 (one message or one batch of @ref CO_DRIVER_RX_BATCH messages per call) by default. It can be
+ * overridden, value 64 is reasonable.
+ */
+#ifndef CO_DRIVER_RX_BUDGET
+#define CO_DRIVER_RX_BUDGET 1
+#endif
+
+/**
+ * Sliding window for rx drop rate
+ *
+ * Messages dropped on socket rx queue are counted per interface in one second slots. Drop rate is the number of
+ * messages dropped within last CO_DRIVER_RX_DROP_WINDOW seconds. If CO_CANptrSocketCan_t.rxDropThreshold is set and
+ * drop rate exceeds it, then CO_CAN_ERRRX_OVERFLOW is set in CANerrorStatus, which triggers CANopen emergency message.
+ * Alarm is disabled with threshold 0 (default), drops are then only counted. See also CO_CANmodule_getRxDrops().
+ *
+ * Macro is set to 10 by default. It can be overridden.
+ */
+#ifndef CO_DRIVER_RX_DROP_WINDOW
+#define CO_DRIVER_RX_DROP_WINDOW 10
+#endif
+
+/**
+ * Minimum launch delay for time triggered transmission
+ *
+ * If CO_CANptrSocketCan_t.txTimeOffset_us is set, each message gets SO_TXTIME launch time, because ETF qdisc drops
+ * messages without launch time or with launch time in the past. Messages, which are not synchronous or are already
+ * late, are launched this number of microseconds after CO_CANsend(). It must cover the time of send() and the "delta"
+ * parameter of ETF qdisc.
+ *
+ * Macro is set to 200 by default. It can be overridden.
+ */
+#ifndef CO_DRIVER_TXTIME_MARGIN
+#define CO_DRIVER_TXTIME_MARGIN 200
+#endif
+
 /* skip this section for Doxygen, because it is documented in CO_driver.h */
 #ifndef CO_DOXYGEN
 
@@ -212,12 +348,27 @@ typedef uint_fast8_t bool_t;
 typedef float float32_t;
 typedef double float64_t;
 
+/* Maximum number of data bytes in CAN message */
+#if CO_DRIVER_CANFD > 0
+#define CO_CAN_DATA_MAX CANFD_MAX_DLEN
+#ifndef CANFD_FDF
+#define CANFD_FDF 0x04 /* defined in linux/can.h since kernel 5.14 */
+#endif
+#else
+#define CO_CAN_DATA_MAX CAN_MAX_DLEN
+#endif
+
 /* CAN receive message structure as aligned in socketCAN. */
 typedef struct {
     uint32_t ident;
-    uint8_t DLC;
+    uint8_t DLC; /* data length, up to 64 bytes with CAN FD */
+#if CO_DRIVER_CANFD > 0
+    uint8_t flags; /* CAN FD flags (CANFD_BRS, CANFD_ESI, CANFD_FDF) */
+    uint8_t padding[2];
+#else
     uint8_t padding[3];
-    uint8_t data[8];
+#endif
+    uint8_t data[CO_CAN_DATA_MAX];
 } CO_CANrxMsg_t;
 
 /* Access to received CAN message */
@@ -246,15 +397,20 @@ typedef struct {
     void* object;
     void (*CANrx_callback)(void* object, void* message);
     int can_ifindex;           /* CAN Interface index from last message */
-    struct timespec timestamp; /* time of reception of last message */
+    struct timespec timestamp; /* time of reception of last message, CLOCK_MONOTONIC */
 } CO_CANrx_t;
 
 /* Transmit message object as aligned in socketCAN. */
 typedef struct {
     uint32_t ident;
-    uint8_t DLC;
+    uint8_t DLC; /* data length, up to 64 bytes with CAN FD */
+#if CO_DRIVER_CANFD > 0
+    uint8_t flags;      /* CAN FD flags (CANFD_BRS, CANFD_ESI, CANFD_FDF) */
+    uint8_t padding[2]; /* ensure alignment */
+#else
     uint8_t padding[3]; /* ensure alignment */
-    uint8_t data[8];
+#endif
+    uint8_t data[CO_CAN_DATA_MAX];
     volatile bool_t bufferFull;
     volatile bool_t syncFlag; /* info about transmit message */
     int can_ifindex;          /* CAN Interface index to use */
@@ -263,17 +419,126 @@ typedef struct {
 /* Max COB ID for standard frame format */
 #define CO_CAN_MSG_SFF_MAX_COB_ID (1 << CAN_SFF_ID_BITS)
 
+/* Value in rx lookup table for identifier, which has no rx buffer assigned */
+#define CO_CAN_RX_INDEX_NONE 0xFFFFU
+
+/* Source of timestamps of received CAN messages. Timestamps are always converted to CLOCK_MONOTONIC. */
+typedef enum {
+    CO_CAN_TIMESTAMP_AUTO = 0,  /* raw hardware, if supported by the CAN interface, software otherwise */
+    CO_CAN_TIMESTAMP_SW = 1,    /* software, taken by the kernel on reception */
+    CO_CAN_TIMESTAMP_HW = 2,    /* hardware, CAN interface clock is synchronized to system clock (phc2sys) */
+    CO_CAN_TIMESTAMP_HW_RAW = 3 /* hardware, free running CAN interface clock */
+} CO_CANtimestamp_t;
+
+/* Type of file descriptor in epoll, see CO_epoll_handler_t */
+typedef enum {
+    CO_EPOLL_HANDLER_EVENT = 0,  /* eventfd of CO_epoll_t */
+    CO_EPOLL_HANDLER_TIMER = 1,  /* timerfd of CO_epoll_t */
+    CO_EPOLL_HANDLER_CAN_RX = 2, /* socketCAN, object is CO_CANmodule_t */
+    CO_EPOLL_HANDLER_CAN_TX = 3, /* duplicate of socketCAN for EPOLLOUT, object is CO_CANmodule_t */
+    CO_EPOLL_HANDLER_GTW = 4,    /* gateway listening socket or io stream, object is CO_epoll_gtw_t */
+    CO_EPOLL_HANDLER_APP = 5     /* file descriptor of application */
+} CO_epoll_handlerType_t;
+
+/* Handler of one file descriptor in epoll. Each file descriptor is registered in epoll with epoll_event.data.ptr
+ * pointing to its handler, so events from one epoll_wait() call are dispatched directly to their owners. */
+typedef struct {
+    int fd;                      /* File descriptor */
+    CO_epoll_handlerType_t type; /* Type of fd */
+    void* object;                /* Owner of fd */
+} CO_epoll_handler_t;
+
+/* Traffic class of tx message, from function code of 11-bit CAN identifier, see CO_CANptrSocketCan_t.txClassRate */
+typedef enum {
+    CO_CAN_TX_CLASS_NMT = 0,   /* NMT, SYNC and TIME */
+    CO_CAN_TX_CLASS_EMCY = 1,  /* Emergency */
+    CO_CAN_TX_CLASS_PDO = 2,   /* TPDO and RPDO */
+    CO_CAN_TX_CLASS_SDO = 3,   /* SDO server and client */
+    CO_CAN_TX_CLASS_HB = 4,    /* Heartbeat, node guarding */
+    CO_CAN_TX_CLASS_OTHER = 5, /* LSS and other identifiers */
+    CO_CAN_TX_CLASS_COUNT = 6
+} CO_CANtxClass_t;
+
 /* CAN interface object (CANptr), passed to CO_CANinit() */
 typedef struct {
-    int can_ifindex; /* CAN Interface index */
-    int epoll_fd;    /* File descriptor for epoll, which waits for CAN receive event */
+    int can_ifindex;             /* CAN Interface index */
+    int epoll_fd;                /* File descriptor for epoll, which waits for CAN receive event */
+    CO_CANtimestamp_t timestamp; /* Requested source of rx timestamps, CO_CAN_TIMESTAMP_AUTO by default */
+    int rxBufferSize;            /* Socket rx buffer size in bytes (SO_RCVBUF), 0 for system default */
+    int rxBufferSizeMax;         /* If larger than rx buffer size, buffer doubles on each rx drop up to this size */
+    int rxBusyPoll_us;           /* If not 0, socket busy polls device queue this time on receive (SO_BUSY_POLL) */
+    uint32_t rxDropThreshold;    /* Rx drops within CO_DRIVER_RX_DROP_WINDOW, which are tolerated, 0 for no alarm */
+    bool_t rxFilterBpf;          /* If true, rx filters are compiled into BPF program, see CO_CANmodule_t */
+    bool_t txLatency;            /* If true, latency of tx messages is measured, see CO_CANmodule_getTxLatency() */
+    uint32_t txTimeOffset_us;    /* If not 0, synchronous messages are launched this time after SYNC, see SO_TXTIME */
+    uint16_t txTimeSyncIdent;    /* CAN identifier of SYNC message for txTimeOffset_us, 0 for default 0x080 */
+    uint32_t txClassRate[CO_CAN_TX_CLASS_COUNT];  /* Tx rate limit in messages per second, 0 for unlimited */
+    uint32_t txClassBurst[CO_CAN_TX_CLASS_COUNT]; /* Messages sent at once above the rate, 0 for one */
+    uint8_t txLoadMax;           /* Bus load in percent of txBitRate, above which SDO and other messages wait, 0 off */
+    uint32_t txBitRate;          /* CAN bit rate in bit/s for txLoadMax, 0 for CANbitRate from CO_CANmodule_init() */
+    CO_CANrx_t* rxEffArray;      /* Optional rx buffers for 29-bit identifiers, see CO_CANrxBufferInitEff() */
+    uint16_t rxEffSize;          /* Number of elements in rxEffArray */
 } CO_CANptrSocketCan_t;
 
+/* Statistics of messages dropped on socket rx queue, see CO_CANmodule_getRxDrops() */
+typedef struct {
+    uint32_t dropCount;  /* Cumulative number of dropped messages */
+    uint32_t dropWindow; /* Number of messages dropped within last CO_DRIVER_RX_DROP_WINDOW seconds */
+    bool_t alarm;        /* threshold is set and dropWindow exceeds it, CO_CAN_ERRRX_OVERFLOW is set */
+} CO_CANrxDropStats_t;
+
+/* Statistics of tx traffic shaper, see CO_CANmodule_getTxShaper() */
+typedef struct {
+    uint32_t deferred[CO_CAN_TX_CLASS_COUNT]; /* Cumulative number of deferred messages for each traffic class */
+    uint32_t loadDeferred;                    /* Of them deferred because of bus load limit */
+} CO_CANtxShaperStats_t;
+
+/* Number of histogram buckets in CO_CANtxLatency_t */
+#define CO_CAN_TX_LATENCY_BUCKETS 16
+
+/* Latency of transmitted CAN messages with one identifier, from CO_CANsend() call to tx timestamp */
+typedef struct {
+    uint16_t ident;  /* 11-bit CAN identifier */
+    uint32_t count;  /* Number of measured messages */
+    uint32_t min_us; /* Minimum latency in microseconds */
+    uint32_t max_us; /* Maximum latency in microseconds */
+    uint64_t sum_us; /* Sum of all latencies, for average */
+    /* Bucket i counts latencies from 2^i to 2^(i+1) microseconds. First bucket counts also latencies below 1 us, last
+     * bucket counts also longer latencies. */
+    uint32_t histogram[CO_CAN_TX_LATENCY_BUCKETS];
+} CO_CANtxLatency_t;
+
 /* socketCAN interface object */
 typedef struct {
-    int can_ifindex;       /* CAN Interface index */
-    char ifName[IFNAMSIZ]; /* CAN Interface name */
-    int fd;                /* socketCAN file descriptor */
+    int can_ifindex;             /* CAN Interface index */
+    char ifName[IFNAMSIZ];       /* CAN Interface name */
+    int fd;                      /* socketCAN file descriptor */
+    int txFd;                    /* Duplicate of fd, in epoll for EPOLLOUT | EPOLLET while tx messages are pending */
+    CO_epoll_handler_t rxHandler; /* epoll_event.data.ptr of fd */
+    CO_epoll_handler_t txHandler; /* epoll_event.data.ptr of txFd */
+    bool_t txWait;               /* EPOLLOUT is armed on txFd */
+    struct CO_CANtxQueue* txQueue; /* unsent tx buffers ordered by CAN identifier, defined in CO_driver.c */
+#if CO_DRIVER_TX_BATCH > 1
+    struct CO_CANtxBatch* txBatch; /* tx staging queue for sendmmsg(), defined in CO_driver.c */
+#endif
+    struct CO_CANtxStampFifo* txStampFifo; /* messages waiting for tx timestamp, if txLatency is enabled */
+    bool_t txTime;               /* SO_TXTIME is enabled on the socket, each message has launch time */
+    struct CO_CANtxShaper* txShaper; /* token buckets, if tx rate or bus load is limited, defined in CO_driver.c */
+#if CO_DRIVER_MULTI_INTERFACE > 0 || defined CO_DOXYGEN
+    uint32_t txLoadBits[2];      /* Bits sent in current and previous window, if tx routes are set */
+    int64_t txLoadWindow_ns;     /* CLOCK_MONOTONIC start of current window */
+#endif
+    CO_CANtimestamp_t timestamp; /* Source of rx timestamps, probed in CO_CANmodule_addInterface() */
+    int64_t tsOffset_ns;         /* Added to raw hardware timestamp gives CLOCK_MONOTONIC time */
+    int64_t tsOffsetMin_ns;      /* Minimum offset seen in current window, for raw hardware timestamps */
+    int64_t tsWindowStart_ns;    /* CLOCK_MONOTONIC start of current window, 0 if offset is not known yet */
+    int rxBufferSize;            /* Socket rx buffer size as reported by the kernel, twice the requested size */
+    int rxBufferSizeMax;         /* Limit for adaptive socket rx buffer size of this interface */
+    uint32_t rxDropCount;        /* Cumulative messages dropped on socket rx queue, from SO_RXQ_OVFL */
+    struct {
+        uint32_t second; /* CLOCK_MONOTONIC second of this slot */
+        uint32_t count;  /* Messages dropped within this second */
+    } rxDropSlots[CO_DRIVER_RX_DROP_WINDOW];
 #if CO_DRIVER_ERROR_REPORTING > 0 || defined CO_DOXYGEN
     CO_CANinterfaceErrorhandler_t errorhandler;
 #endif
@@ -287,17 +552,75 @@ typedef struct {
     CO_CANrx_t* rxArray;
     uint16_t rxSize;
     struct can_filter* rxFilter; /* socketCAN filter list, one per rx buffer */
-    uint32_t rxDropCount;        /* messages dropped on rx socket queue */
+    /* If true, rx filters are compiled into classic BPF program attached with SO_ATTACH_FILTER, instead of linear
+     * CAN_RAW_FILTER list. Identifiers with exact match are merged into ranges and searched with binary tree. */
+    bool_t rxFilterBpf;
+    /* Rx filters changed while CANnormal, they are installed by next CO_CANmodule_process() or by
+     * CO_CANmodule_rxFiltersCommit(), so many changes cause single reinstall. */
+    volatile bool_t rxFilterDirty;
+    bool_t rxFilterFailed;     /* Last install failed, it is repeated after short delay */
+    uint16_t rxFilterHold;     /* Nesting level of CO_CANmodule_rxFiltersBegin(), no install if nonzero */
+    uint32_t rxFilterInstalls; /* Number of times rx filters were installed into the kernel */
+    /* Lookup table 11-bit CAN identifier to rxArray index, for rx buffers with exact match of the identifier. If more
+     * buffers match, then lowest index is used. CO_CAN_RX_INDEX_NONE, if no buffer matches. */
+    uint16_t rxIdentToIndex[CO_CAN_MSG_SFF_MAX_COB_ID];
+    uint16_t* rxMasked;          /* Ascending list of rxArray indexes, which are not in rxIdentToIndex */
+    uint16_t rxMaskedCount;      /* Number of entries in rxMasked */
+    uint32_t rxDropCount;        /* messages dropped on rx socket queue, sum of all interfaces */
+    uint32_t rxDropThreshold;    /* Rx drops within window, which are tolerated, 0 for no alarm, from CANptr */
+    CO_CANtimestamp_t timestamp; /* Requested source of rx timestamps, from CANptr */
+    int rxBufferSize;            /* Socket rx buffer size for new interfaces, from CANptr */
+    int rxBufferSizeMax;         /* Limit for adaptive socket rx buffer size for new interfaces, from CANptr */
+    int rxBusyPoll_us;           /* SO_BUSY_POLL time for new interfaces, from CANptr */
+    CO_CANrx_t* rxEffArray;      /* Rx buffers for 29-bit identifiers, from CANptr */
+    uint16_t rxEffSize;          /* Number of elements in rxEffArray */
+    uint16_t* rxEffSorted;       /* rxEffArray indexes with exact match of identifier, sorted by identifier */
+    uint16_t rxEffSortedCount;   /* Number of entries in rxEffSorted */
+    uint16_t* rxEffMasked;       /* Ascending list of rxEffArray indexes, which use mask */
+    uint16_t rxEffMaskedCount;   /* Number of entries in rxEffMasked */
+#if CO_DRIVER_RX_BATCH > 1
+    struct CO_CANrxBatch* rxBatch; /* preallocated buffers for recvmmsg(), defined in CO_driver.c */
+#endif
+    bool_t txLatency;                /* Tx latency is measured, from CANptr */
+    /* Time triggered transmission of synchronous messages with SO_TXTIME and CLOCK_TAI, for ETF qdisc. Message with
+     * syncFlag is launched txTimeOffset_us after the SYNC message was received or sent, 0 if disabled. */
+    uint32_t txTimeOffset_us;
+    uint32_t txTimeSyncIdent; /* CAN identifier of SYNC message, from CANptr */
+    int64_t txTimeSync_ns;    /* CLOCK_MONOTONIC time of last SYNC message, 0 if none yet */
+    /* Token bucket traffic shaper for each interface, parameters from CANptr. Messages over the limit wait in the tx
+     * queue of the interface and are sent by CO_CANmodule_txFlush() or CO_CANmodule_process(). */
+    uint32_t txClassRate[CO_CAN_TX_CLASS_COUNT];
+    uint32_t txClassBurst[CO_CAN_TX_CLASS_COUNT];
+    uint32_t txLoadRate;             /* Allowed bus load in bit/s, 0 if unlimited */
+    int64_t txShaperNext_ns;         /* CLOCK_MONOTONIC time, when first deferred message has credit, 0 if none */
+    struct CO_CANtxStamps* txStamps; /* Tx latency statistics, defined in CO_driver.c */
+    /* Number of copies of each tx buffer, which wait in rings or tx queues, see CO_CANmodule_txConsumer(). Buffer has
+     * bufferFull set, while its count is nonzero. */
+    uint16_t* txPending;
+    uint16_t txErrorStatus; /* CO_CAN_ERRTX_* bits from threads without own error status, merged into CANerrorStatus */
+#ifndef CO_SINGLE_THREAD
+    /* Only the tx consumer writes to sockets and owns tx queues. Other threads pass copies of messages to it through
+     * rings, see @ref CO_DRIVER_TX_PRODUCERS. */
+    pthread_t txConsumer;
+    volatile bool_t txConsumerSet;
+    struct CO_CANtxRing* txRings;      /* CO_DRIVER_TX_PRODUCERS rings, defined in CO_driver.c */
+    int txEventFd;                     /* eventfd, which wakes up the tx consumer */
+    CO_epoll_handler_t txEventHandler; /* epoll_event.data.ptr of txEventFd */
+    volatile bool_t txKick;            /* txEventFd was written and the consumer has not yet drained the rings */
+    volatile uint32_t txRequest;       /* CO_CAN_TX_REQ_* bits from other threads, defined in CO_driver.c */
+    pthread_mutex_t txStampMutex;      /* protects tx latency statistics, if enabled */
+#endif
     CO_CANtx_t* txArray;
     uint16_t txSize;
     uint16_t CANerrorStatus;
     volatile bool_t CANnormal;
     volatile uint16_t CANtxCount;
+    uint32_t txSyncPurged; /* Synchronous messages removed from tx queues by CO_CANclearPendingSyncPDOs() */
     int epoll_fd; /* File descriptor for epoll, which waits for CAN receive event */
 #if CO_DRIVER_MULTI_INTERFACE > 0 || defined CO_DOXYGEN
-    /* Lookup tables Cob ID to rx/tx array index.  Only feasible for SFF Messages. */
-    uint32_t rxIdentToIndex[CO_CAN_MSG_SFF_MAX_COB_ID];
+    /* Lookup table Cob ID to tx array index.  Only feasible for SFF Messages. */
     uint32_t txIdentToIndex[CO_CAN_MSG_SFF_MAX_COB_ID];
+    struct CO_CANtxRoutes* txRoutes; /* Routing table, see CO_CANmodule_setTxRoutes(), defined in CO_driver.c */
 #endif
 } CO_CANmodule_t;
 
@@ -333,7 +656,7 @@ typedef struct {
 #define CO_MemoryBarrier()
 #else
 
-/* (un)lock critical section in CO_CANsend() - unused */
+/* (un)lock critical section in CO_CANsend() - unused, CO_CANsend() is lock-free, see CO_DRIVER_TX_PRODUCERS */
 #define CO_LOCK_CAN_SEND(CAN_MODULE)
 #define CO_UNLOCK_CAN_SEND(CAN_MODULE)
 
@@ -392,11 +715,14 @@ CO_UNLOCK_OD(CO_CANmodule_t* CANmodule) {
  *
  * Function must be called after CO_CANmodule_init.
  *
+ * Each interface has own tx queue. If socket of one interface is full, messages for it are queued and re-sent in CAN
+ * priority order, while other interfaces continue to transmit. CANerrorStatus combines errors of all interfaces.
+ *
  * @param CANmodule This object will be initialized.
  * @param can_ifindex CAN Interface index
- * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT, CO_ERROR_SYSCALL or CO_ERROR_INVALID_STATE.
+ * @return True on success. False on illegal argument, system call error or if CANmodule is in CANnormal mode.
  */
-CO_ReturnError_t CO_CANmodule_addInterface(CO_CANmodule_t* CANmodule, int can_ifindex);
+bool_t CO_CANmodule_addInterface(CO_CANmodule_t* CANmodule, int can_ifindex);
 
 /**
  * Check on which interface the last message for one message buffer was received
@@ -406,13 +732,13 @@ CO_ReturnError_t CO_CANmodule_addInterface(CO_CANmodule_t* CANmodule, int can_if
  *
  * @param CANmodule This object.
  * @param ident 11-bit standard CAN Identifier.
- * @param [out] CANptrRx message was received on this interface
- * @param [out] timestamp message was received at this time (system clock)
+ * @param [out] can_ifindexRx message was received on this interface (CAN Interface index)
+ * @param [out] timestamp message was received at this time (CLOCK_MONOTONIC, see #CO_CANtimestamp_t)
  *
- * @retval false message has never been received, therefore no base address and timestamp are available
- * @retval true base address and timestamp are valid
+ * @retval false message has never been received, therefore no interface index and timestamp are available
+ * @retval true interface index and timestamp are valid
  */
-bool_t CO_CANrxBuffer_getInterface(CO_CANmodule_t* CANmodule, uint16_t ident, const void** const CANptrRx,
+bool_t CO_CANrxBuffer_getInterface(CO_CANmodule_t* CANmodule, uint16_t ident, int* can_ifindexRx,
                                    struct timespec* timestamp);
 
 /**
@@ -421,22 +747,62 @@ bool_t CO_CANrxBuffer_getInterface(CO_CANmodule_t* CANmodule, uint16_t ident, co
  * It is in the responsibility of the user to ensure that the correct interface is used. Some messages need to be
  * transmitted on all interfaces.
  *
- * If given interface is unknown or NULL is used, a message is transmitted on all available interfaces.
+ * If given interface is unknown or 0 is used, a message is transmitted on all available interfaces.
  *
  * @param CANmodule This object.
  * @param ident 11-bit standard CAN Identifier.
- * @param CANptrTx use this interface. NULL = not specified
+ * @param can_ifindexTx use this interface (CAN Interface index). 0 = not specified
  *
- * @return #CO_ReturnError_t: CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT.
+ * @return True on success, false if there is no tx buffer for the identifier.
  */
-CO_ReturnError_t CO_CANtxBuffer_setInterface(CO_CANmodule_t* CANmodule, uint16_t ident, const void* CANptrTx);
+bool_t CO_CANtxBuffer_setInterface(CO_CANmodule_t* CANmodule, uint16_t ident, int can_ifindexTx);
+
+/**
+ * Entry of tx routing table, see CO_CANmodule_setTxRoutes()
+ *
+ * Range of identifiers may also cover function code fc of CiA301 predefined connection set: identFirst = fc << 7,
+ * identLast = (fc << 7) | 0x7F.
+ */
+typedef struct {
+    uint16_t identFirst; /**< First 11-bit CAN identifier of the range */
+    uint16_t identLast;  /**< Last 11-bit CAN identifier of the range, inclusive */
+    uint32_t interfaces; /**< Set of interfaces, bit n is n-th interface added by CO_CANmodule_addInterface() */
+    bool_t leastLoaded;  /**< If true, message is sent on one interface from the set, which has the lowest tx load. If
+                              false, message is sent on all interfaces from the set. */
+} CO_CANtxRoute_t;
+
+/**
+ * Set tx routing table
+ *
+ * Without routing table each message is sent on all interfaces, which wastes bandwidth, if process data is split
+ * across several buses. Routing table maps ranges of CAN identifiers to sets of interfaces. First matching entry is
+ * used, messages with identifier not in the table and 29-bit messages are sent on all interfaces. Interface selected
+ * with CO_CANtxBuffer_setInterface() has precedence over routing table.
+ *
+ * With leastLoaded the interface is selected for each message by measured tx load: bits sent within last 100
+ * milliseconds, with worst case bit stuffing, plus messages waiting in the tx queue of the interface. Interface in
+ * listen only mode (bus off or no ack) is not selected, while other interface from the set is available.
+ *
+ * Function must be called after all interfaces are added and before CO_CANsetNormalMode(). Table is copied.
+ *
+ * @param CANmodule This object.
+ * @param routes Routing table, NULL to remove it.
+ * @param count Number of entries in routes, up to 255.
+ *
+ * @return True on success. False, if entry has invalid range or has no added interface, or if CANmodule is in
+ * CANnormal mode.
+ */
+bool_t CO_CANmodule_setTxRoutes(CO_CANmodule_t* CANmodule, const CO_CANtxRoute_t routes[], uint16_t count);
 #endif /* CO_DRIVER_MULTI_INTERFACE */
 
 /**
  * Receives CAN messages from matching epoll event
  *
- * This function verifies, if epoll event matches event from any CANinterface. In case of match, message is read from
- * CAN and pre-processed for CANopenNode objects. CAN error frames are also processed.
+ * This function verifies, if epoll event matches event from any CANinterface. Event matches, if its
+ * epoll_event.data.ptr points to CO_epoll_handler_t of CAN socket of this CANmodule, so the interface is found without
+ * search. All file descriptors in the same epoll must be registered with data.ptr pointing to CO_epoll_handler_t. In
+ * case of match, message is read from CAN and pre-processed for CANopenNode objects. CAN error frames are also
+ * processed.
  *
  * In case of CAN message function searches _rxArray_ from CO_CANmodule_t and if matched it calls the corresponding
  * CANrx_callback, optionally copies received CAN message to _buffer_ and returns index of matched _rxArray_.
@@ -445,6 +811,9 @@ CO_ReturnError_t CO_CANtxBuffer_setInterface(CO_CANmodule_t* CANmodule, uint16_t
  * - automatic mode: If CANrx_callback is specified for matched _rxArray_, then   calls its callback.
  * - manual mode: evaluate message filters, return received message
  *
+ * If @ref CO_DRIVER_RX_BATCH or @ref CO_DRIVER_RX_BUDGET is larger than 1, then multiple messages may be read and
+ * dispatched at once. In that case _buffer_ and _msgIndex_ contain the last received message.
+ *
  * @param CANmodule This object.
  * @param ev Epoll event, which vill be verified for matches.
  * @param [out] buffer Storage for received message or _NULL_ if not used.
@@ -455,6 +824,187 @@ CO_ReturnError_t CO_CANtxBuffer_setInterface(CO_CANmodule_t* CANmodule, uint16_t
  */
 bool_t CO_CANrxFromEpoll(CO_CANmodule_t* CANmodule, struct epoll_event* ev, CO_CANrxMsg_t* buffer, int32_t* msgIndex);
 
+/**
+ * Configure CAN message receive buffer for 29-bit identifier
+ *
+ * The same as CO_CANrxBufferInit(), but for extended frame format, for example to consume J1939 messages besides
+ * CANopen. Buffers are provided by application in CO_CANptrSocketCan_t.rxEffArray and are cleared by
+ * CO_CANmodule_init(), so they must be configured after each CO_CANinit(). Kernel filters include these buffers, they
+ * are updated as described in CO_CANmodule_rxFiltersBegin().
+ *
+ * Received message is found by binary search over buffers with exact match of the identifier. If there is no exact
+ * match, buffers with mask are searched in order. CANrx_callback gets CO_CANrxMsg_t, where _ident_ contains 29-bit
+ * identifier and CAN_EFF_FLAG (CO_CANrxMsg_readIdent() returns 11-bit identifier only). In manual mode of
+ * CO_CANrxFromEpoll() _msgIndex_ for these buffers is rxSize + index.
+ *
+ * @param CANmodule This object.
+ * @param index Index of the buffer in rxEffArray.
+ * @param ident 29-bit CAN identifier.
+ * @param mask Mask for identifier, bits set to 1 must match. Use CAN_EFF_MASK for exact match.
+ * @param rtr If true, 'Remote Transmit Request' messages will be accepted.
+ * @param object CANopen object, to which buffer is connected. It will be used as an argument to CANrx_callback.
+ * @param CANrx_callback Pointer to function, which will be called, if received CAN message matches the identifier.
+ *
+ * @return True on success, false on illegal argument.
+ */
+bool_t CO_CANrxBufferInitEff(CO_CANmodule_t* CANmodule, uint16_t index, uint32_t ident, uint32_t mask, bool_t rtr,
+                             void* object, void (*CANrx_callback)(void* object, void* message));
+
+/**
+ * Set size of socket rx buffer for CAN interface
+ *
+ * SO_RCVBUFFORCE is used, if process has CAP_NET_ADMIN, otherwise SO_RCVBUF, which is limited by
+ * /proc/sys/net/core/rmem_max. Kernel reserves around 450 bytes for each CAN message. Function may be called at any
+ * time after the interface is added.
+ *
+ * Initial size and limit for adaptive growing on rx drops are specified by CO_CANptrSocketCan_t.
+ *
+ * @param CANmodule This object.
+ * @param can_ifindex CAN Interface index, 0 for all interfaces (also for interfaces added later).
+ * @param bytes Requested buffer size in bytes.
+ * @param bytesMax If larger than bytes, buffer size of the interface doubles on each rx queue overflow up to this
+ * size.
+ *
+ * @return True, if buffer size was set on all matching interfaces.
+ */
+bool_t CO_CANmodule_setRxBufferSize(CO_CANmodule_t* CANmodule, int can_ifindex, int bytes, int bytesMax);
+
+/**
+ * Get statistics of messages dropped on socket rx queue
+ *
+ * Messages are dropped, if they are not read fast enough, see also CO_CANmodule_setRxBufferSize(). Function may be
+ * called from any thread.
+ *
+ * @param CANmodule This object.
+ * @param can_ifindex CAN Interface index, 0 for sum of all interfaces.
+ * @param [out] stats Statistics, see CO_CANrxDropStats_t.
+ *
+ * @return True, if interface was found.
+ */
+bool_t CO_CANmodule_getRxDrops(CO_CANmodule_t* CANmodule, int can_ifindex, CO_CANrxDropStats_t* stats);
+
+/**
+ * Get statistics of tx traffic shaper
+ *
+ * Shaper classifies tx messages by function code of CAN identifier, see CO_CANtxClass_t. Each class may have token
+ * bucket rate limit, CO_CANptrSocketCan_t.txClassRate and txClassBurst. Bus load limit, txLoadMax, is token bucket for
+ * bits on the bus, averaged over 10 milliseconds. Frame length includes worst case bit stuffing, CAN FD frames are
+ * counted as classical frames with the same payload. All sent messages are counted into the bus load, but only SDO and
+ * other messages wait for it, so low priority bulk transfers do not crowd the bus. Messages over the limit are
+ * deferred, they wait in the tx queue of the interface. If tx buffer is sent again, while its message is deferred,
+ * newer message replaces it without tx overflow error. Function may be called from any thread.
+ *
+ * @param CANmodule This object.
+ * @param can_ifindex CAN Interface index, 0 for sum of all interfaces.
+ * @param [out] stats Statistics, see CO_CANtxShaperStats_t.
+ *
+ * @return True, if interface was found and shaper is enabled.
+ */
+bool_t CO_CANmodule_getTxShaper(CO_CANmodule_t* CANmodule, int can_ifindex, CO_CANtxShaperStats_t* stats);
+
+/**
+ * Begin transaction of rx buffer configuration
+ *
+ * Changes of rx buffers by CO_CANrxBufferInit() or CO_CANrxBufferInitEff() in CANnormal mode are not installed into the
+ * kernel immediately, they are marked dirty and installed once by the next CO_CANmodule_process(). Mainline calls it
+ * without delay, see CO_CANmodule_rxFiltersNext_us(). Inside transaction they are not installed until
+ * CO_CANmodule_rxFiltersCommit(), so for example reconfiguration of many RPDOs causes single reinstall. Messages are
+ * always matched also by the driver, so pending filters never cause reception of wrong messages. But messages with
+ * newly configured identifier may be dropped by the kernel, until filters are installed.
+ *
+ * Transactions may be nested. Function must be called from the same thread as CO_CANrxBufferInit().
+ *
+ * @param CANmodule This object.
+ */
+void CO_CANmodule_rxFiltersBegin(CO_CANmodule_t* CANmodule);
+
+/**
+ * End transaction of rx buffer configuration
+ *
+ * If outermost transaction is ended and filters are dirty, they are installed into the kernel.
+ *
+ * @param CANmodule This object.
+ *
+ * @return False, if kernel filters could not be set.
+ */
+bool_t CO_CANmodule_rxFiltersCommit(CO_CANmodule_t* CANmodule);
+
+/**
+ * Get time, until changed rx filters should be installed
+ *
+ * Mainline should call CO_CANmodule_process() after this time, see CO_CANmodule_rxFiltersBegin(). Function must be
+ * called from the same thread as CO_CANrxBufferInit().
+ *
+ * @param CANmodule This object.
+ *
+ * @return Time in microseconds, 0 if filters are dirty and outside of transaction, UINT32_MAX if nothing is pending.
+ * If the last install failed, it is repeated after short delay.
+ */
+uint32_t CO_CANmodule_rxFiltersNext_us(CO_CANmodule_t* CANmodule);
+
+/**
+ * Write staged CAN messages to the socket
+ *
+ * Messages, staged by CO_CANsend(), are written with single sendmmsg() system call, see @ref CO_DRIVER_TX_BATCH.
+ * Messages, deferred by tx shaper, are re-sent, if they have credit now, see CO_CANmodule_getTxShaper(). Function may
+ * be called from any thread, but only the tx consumer writes, see CO_CANmodule_txConsumer(). Messages from other
+ * threads are flushed by the consumer, after it takes them from the rings.
+ *
+ * @param CANmodule This object.
+ *
+ * @return Number of messages, which remain in the queue, because socket tx queue is full.
+ */
+uint32_t CO_CANmodule_txFlush(CO_CANmodule_t* CANmodule);
+
+/**
+ * Get time, until message deferred by tx shaper may be sent
+ *
+ * Mainline should call CO_CANmodule_process() after this time, see CO_CANmodule_getTxShaper(). Function may be called
+ * from any thread.
+ *
+ * @param CANmodule This object.
+ *
+ * @return Time in microseconds, 0 if credit is available now, UINT32_MAX if no message is deferred.
+ */
+uint32_t CO_CANmodule_txShaperNext_us(CO_CANmodule_t* CANmodule);
+
+/**
+ * Make calling thread the tx consumer
+ *
+ * Tx consumer writes CAN messages to sockets, also messages, which other threads pass to it with CO_CANsend(), see
+ * @ref CO_DRIVER_TX_PRODUCERS. Consumer must be the thread, which waits on CO_CANptrSocketCan_t.epoll_fd and calls
+ * CO_CANrxFromEpoll(), because it is woken up there. Function is called by CO_epoll_processRT() and returns
+ * immediately, if calling thread is already the consumer.
+ *
+ * CO_CANsend() from the consumer returns errors of the socket, as described in CO_driver.h. CO_CANsend() from other
+ * thread returns CO_ERROR_NO or CO_ERROR_TX_BUSY (previous message from the same tx buffer is still waiting in the
+ * driver), if message was accepted, or CO_ERROR_TX_OVERFLOW, if it was dropped, because the ring is full. Errors,
+ * which happen later in the consumer, are indicated in CANerrorStatus.
+ *
+ * @param CANmodule This object.
+ */
+void CO_CANmodule_txConsumer(CO_CANmodule_t* CANmodule);
+
+/**
+ * Get latency statistics of transmitted CAN messages
+ *
+ * If CO_CANptrSocketCan_t.txLatency is set, then tx timestamps are enabled on each socket (SO_TIMESTAMPING with
+ * SOF_TIMESTAMPING_TX_SOFTWARE or, if hardware timestamps are used, SOF_TIMESTAMPING_TX_HARDWARE). Kernel returns
+ * each sent message with its tx timestamp on the socket error queue, which is read by CO_CANrxFromEpoll(). Message is
+ * matched with the time of CO_CANsend() call, so latency includes time in the driver tx queue, in the kernel queue
+ * and in the CAN controller. Software tx timestamp is taken, when message is passed to the CAN controller, hardware
+ * timestamp, when it is on the bus. Drivers support tx timestamps since Linux 5.18.
+ *
+ * Statistics are collected for each 11-bit CAN identifier. Function may be called from any thread.
+ *
+ * @param CANmodule This object.
+ * @param n Index of CAN identifier, 0 for the first one.
+ * @param [out] latency Statistics for n-th identifier.
+ *
+ * @return False, if n is out of range or measurement is disabled.
+ */
+bool_t CO_CANmodule_getTxLatency(CO_CANmodule_t* CANmodule, uint16_t n, CO_CANtxLatency_t* latency);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -33,6 +33,7 @@
 
 #if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
 #include <stdio.h>
+#include <stdarg.h>
 #include <ctype.h>
 #include <limits.h>
 #include <sys/socket.h>
@@ -45,9 +46,10 @@
 #endif
 #endif /* (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII */
 
-/* delay for recall CANsend(), if CAN TX buffer is full */
+/* delay for recall CANsend(), if CAN TX buffer is full. Unsent messages are normally sent by CO_CANrxFromEpoll(), as
+ * soon as CAN socket is writable again. This is fallback, if other process fills the CAN interface tx queue. */
 #ifndef CANSEND_DELAY_US
-#define CANSEND_DELAY_US 100
+#define CANSEND_DELAY_US 10000
 #endif
 
 /* EPOLL **********************************************************************/
@@ -71,6 +73,7 @@ CO_epoll_create(CO_epoll_t* ep, uint32_t timerInterval_us) {
 
     /* Configure epoll for mainline */
     ep->epoll_new = false;
+    ep->eventCount = 0;
     ep->epoll_fd = epoll_create(1);
     if (ep->epoll_fd < 0) {
         log_printf(LOG_CRIT, DBG_ERRNO, "epoll_create()");
@@ -83,9 +86,12 @@ CO_epoll_create(CO_epoll_t* ep, uint32_t timerInterval_us) {
         log_printf(LOG_CRIT, DBG_ERRNO, "eventfd()");
         return CO_ERROR_SYSCALL;
     }
+    ep->eventHandler.fd = ep->event_fd;
+    ep->eventHandler.type = CO_EPOLL_HANDLER_EVENT;
+    ep->eventHandler.object = ep;
     ev.events = EPOLLIN;
-    ev.data.fd = ep->event_fd;
-    ret = epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+    ev.data.ptr = &ep->eventHandler;
+    ret = epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, ep->event_fd, &ev);
     if (ret < 0) {
         log_printf(LOG_CRIT, DBG_ERRNO, "epoll_ctl(event_fd)");
         return CO_ERROR_SYSCALL;
@@ -106,9 +112,12 @@ CO_epoll_create(CO_epoll_t* ep, uint32_t timerInterval_us) {
         log_printf(LOG_CRIT, DBG_ERRNO, "timerfd_settime");
         return CO_ERROR_SYSCALL;
     }
+    ep->timerHandler.fd = ep->timer_fd;
+    ep->timerHandler.type = CO_EPOLL_HANDLER_TIMER;
+    ep->timerHandler.object = ep;
     ev.events = EPOLLIN;
-    ev.data.fd = ep->timer_fd;
-    ret = epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+    ev.data.ptr = &ep->timerHandler;
+    ret = epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, ep->timer_fd, &ev);
     if (ret < 0) {
         log_printf(LOG_CRIT, DBG_ERRNO, "epoll_ctl(timer_fd)");
         return CO_ERROR_SYSCALL;
@@ -116,10 +125,117 @@ CO_epoll_create(CO_epoll_t* ep, uint32_t timerInterval_us) {
     ep->timerInterval_us = timerInterval_us;
     ep->previousTime_us = clock_gettime_us();
     ep->timeDifference_us = 0;
+    ep->tickless = false;
+    ep->timerIdle_us = UINT32_MAX;
+    ep->timerDeadline_us = 0;
+    ep->spin_us = 0;
+    ep->spinHits = 0;
+    ep->spinMisses = 0;
+    ep->timerExpected_us = ep->previousTime_us;
+    memset(&ep->latency, 0, sizeof(ep->latency));
+    ep->latency.min_us = UINT32_MAX;
+    ep->statsSequence = 0;
 
     return CO_ERROR_NO;
 }
 
+CO_ReturnError_t
+CO_epoll_setTickless(CO_epoll_t* ep, bool_t tickless) {
+    struct itimerspec tm = {0};
+
+    if (ep == NULL || ep->timer_fd < 0) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    /* trigger immediately, tickless timer is then re-armed by CO_epoll_processLast() */
+    if (!tickless) {
+        tm.it_interval = ep->tm.it_interval;
+    }
+    tm.it_value.tv_nsec = 1;
+    if (timerfd_settime(ep->timer_fd, 0, &tm, NULL) < 0) {
+        log_printf(LOG_CRIT, DBG_ERRNO, "timerfd_settime");
+        return CO_ERROR_SYSCALL;
+    }
+    ep->tickless = tickless;
+    ep->timerExpected_us = clock_gettime_us();
+    ep->timerDeadline_us = tickless ? ep->timerExpected_us : 0;
+
+    return CO_ERROR_NO;
+}
+
+/* Begin and end update of statistics, readers in other threads retry while sequence is odd or has changed */
+static inline void
+CO_epoll_statsBegin(CO_epoll_t* ep) {
+    __atomic_store_n(&ep->statsSequence, ep->statsSequence + 1U, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void
+CO_epoll_statsEnd(CO_epoll_t* ep) {
+    __atomic_store_n(&ep->statsSequence, ep->statsSequence + 1U, __ATOMIC_RELEASE);
+}
+
+/* Add latency of timer wakeup, expirations is the value read from timer_fd */
+static void
+CO_epoll_addLatency(CO_epoll_t* ep, uint64_t now, uint64_t expirations) {
+    CO_epoll_latency_t* latency = &ep->latency;
+    uint32_t latency_us = (now > ep->timerExpected_us) ? (uint32_t)(now - ep->timerExpected_us) : 0;
+    uint32_t bucket = 0;
+
+    CO_epoll_statsBegin(ep);
+    latency->count++;
+    latency->sum_us += latency_us;
+    if (latency_us < latency->min_us) {
+        latency->min_us = latency_us;
+    }
+    if (latency_us > latency->max_us) {
+        latency->max_us = latency_us;
+    }
+    for (uint32_t v = latency_us; v > 1U && bucket < (CO_EPOLL_LATENCY_BUCKETS - 1U); v >>= 1) {
+        bucket++;
+    }
+    latency->histogram[bucket]++;
+
+    if (expirations > 1) {
+        latency->overruns += (uint32_t)(expirations - 1);
+    }
+    CO_epoll_statsEnd(ep);
+
+    /* tickless timer is armed again in CO_epoll_processLast() */
+    if (!ep->tickless) {
+        ep->timerExpected_us += expirations * ep->timerInterval_us;
+    }
+}
+
+void
+CO_epoll_getStatistics(const CO_epoll_t* ep, CO_epoll_latency_t* latency, uint32_t* spinHits,
+                       uint32_t* spinMisses) {
+    CO_epoll_latency_t latencyCopy;
+    uint32_t hits, misses, sequence;
+
+    if (ep == NULL) {
+        return;
+    }
+
+    do {
+        sequence = __atomic_load_n(&ep->statsSequence, __ATOMIC_ACQUIRE);
+        latencyCopy = ep->latency;
+        hits = ep->spinHits;
+        misses = ep->spinMisses;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((sequence & 1U) != 0 || sequence != __atomic_load_n(&ep->statsSequence, __ATOMIC_RELAXED));
+
+    if (latency != NULL) {
+        *latency = latencyCopy;
+    }
+    if (spinHits != NULL) {
+        *spinHits = hits;
+    }
+    if (spinMisses != NULL) {
+        *spinMisses = misses;
+    }
+}
+
 void
 CO_epoll_close(CO_epoll_t* ep) {
     if (ep == NULL) {
@@ -142,40 +258,69 @@ CO_epoll_wait(CO_epoll_t* ep) {
         return;
     }
 
-    /* wait for an event */
-    int ready = epoll_wait(ep->epoll_fd, &ep->ev, 1, -1);
-    ep->epoll_new = true;
+    /* wait for events, in hybrid mode poll first without sleeping */
+    int ready = 0;
+    if (ep->spin_us > 0) {
+        uint64_t spinEnd = clock_gettime_us() + ep->spin_us;
+        do {
+            ready = epoll_wait(ep->epoll_fd, ep->events, CO_EPOLL_EVENTS_MAX, 0);
+        } while (ready == 0 && clock_gettime_us() < spinEnd);
+        CO_epoll_statsBegin(ep);
+        if (ready > 0) {
+            ep->spinHits++;
+        } else if (ready == 0) {
+            ep->spinMisses++;
+        }
+        CO_epoll_statsEnd(ep);
+    }
+    if (ready == 0) {
+        ready = epoll_wait(ep->epoll_fd, ep->events, CO_EPOLL_EVENTS_MAX, -1);
+    }
+    ep->eventCount = 0;
+    ep->epoll_new = false;
     ep->timerEvent = false;
 
     /* calculate time difference since last call */
     uint64_t now = clock_gettime_us();
     ep->timeDifference_us = (uint32_t)(now - ep->previousTime_us);
     ep->previousTime_us = now;
-    /* application may will lower this */
-    ep->timerNext_us = ep->timerInterval_us;
+    /* application may will lower this, tickless timer is armed only for reported deadlines */
+    ep->timerNext_us = ep->tickless ? ep->timerIdle_us : ep->timerInterval_us;
 
-    /* process event */
-    if (ready != 1 && errno == EINTR) {
-        /* event from interrupt or signal, nothing to process, continue */
-        ep->epoll_new = false;
-    } else if (ready != 1) {
-        log_printf(LOG_DEBUG, DBG_ERRNO, "epoll_wait");
-        ep->epoll_new = false;
-    } else if ((ep->ev.events & EPOLLIN) != 0 && ep->ev.data.fd == ep->event_fd) {
-        uint64_t val;
-        ssize_t s = read(ep->event_fd, &val, sizeof(uint64_t));
-        if (s != sizeof(uint64_t)) {
-            log_printf(LOG_DEBUG, DBG_ERRNO, "read(event_fd)");
+    if (ready < 0) {
+        if (errno != EINTR) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "epoll_wait");
         }
-        ep->epoll_new = false;
-    } else if ((ep->ev.events & EPOLLIN) != 0 && ep->ev.data.fd == ep->timer_fd) {
-        uint64_t val;
-        ssize_t s = read(ep->timer_fd, &val, sizeof(uint64_t));
-        if (s != sizeof(uint64_t) && errno != EAGAIN) {
-            log_printf(LOG_DEBUG, DBG_ERRNO, "read(timer_fd)");
+        /* event from interrupt or signal, nothing to process, continue */
+        return;
+    }
+
+    /* process own events, others are dispatched by processing functions */
+    ep->eventCount = ready;
+    for (int i = 0; i < ready; i++) {
+        struct epoll_event* ev = &ep->events[i];
+
+        if ((ev->events & EPOLLIN) != 0 && ev->data.ptr == &ep->eventHandler) {
+            uint64_t val;
+            ssize_t s = read(ep->event_fd, &val, sizeof(uint64_t));
+            if (s != sizeof(uint64_t)) {
+                log_printf(LOG_DEBUG, DBG_ERRNO, "read(event_fd)");
+            }
+            ev->events = 0;
+        } else if ((ev->events & EPOLLIN) != 0 && ev->data.ptr == &ep->timerHandler) {
+            uint64_t val;
+            ssize_t s = read(ep->timer_fd, &val, sizeof(uint64_t));
+            if (s == sizeof(uint64_t)) {
+                CO_epoll_addLatency(ep, now, val);
+            } else if (errno != EAGAIN) {
+                log_printf(LOG_DEBUG, DBG_ERRNO, "read(timer_fd)");
+            }
+            ev->events = 0;
+            ep->timerEvent = true;
+            ep->timerDeadline_us = 0;
+        } else {
+            ep->epoll_new = true;
         }
-        ep->epoll_new = false;
-        ep->timerEvent = true;
     }
 }
 
@@ -186,12 +331,33 @@ CO_epoll_processLast(CO_epoll_t* ep) {
     }
 
     if (ep->epoll_new) {
-        log_printf(LOG_DEBUG, DBG_EPOLL_UNKNOWN, ep->ev.events, ep->ev.data.fd);
+        for (int i = 0; i < ep->eventCount; i++) {
+            const CO_epoll_handler_t* handler = (const CO_epoll_handler_t*)ep->events[i].data.ptr;
+            if (ep->events[i].events != 0) {
+                log_printf(LOG_DEBUG, DBG_EPOLL_UNKNOWN, ep->events[i].events, (handler != NULL) ? handler->fd : -1);
+            }
+        }
         ep->epoll_new = false;
     }
 
-    /* lower next timer interval if changed by application */
-    if (ep->timerNext_us < ep->timerInterval_us) {
+    if (ep->tickless) {
+        /* Deadline is relative to the last CO_epoll_wait(), add one microsecond extra delay. Armed deadline is kept, if
+         * it is not later: early wakeup is harmless, deadline is then calculated again. */
+        uint64_t deadline = ep->previousTime_us + ep->timerNext_us + 1;
+        if (ep->timerDeadline_us == 0 || deadline < ep->timerDeadline_us) {
+            struct itimerspec tm = {0};
+            tm.it_value.tv_sec = deadline / 1000000;
+            tm.it_value.tv_nsec = (deadline % 1000000) * 1000;
+            int ret = timerfd_settime(ep->timer_fd, TFD_TIMER_ABSTIME, &tm, NULL);
+            if (ret < 0) {
+                log_printf(LOG_DEBUG, DBG_ERRNO, "timerfd_settime");
+            } else {
+                ep->timerDeadline_us = deadline;
+                ep->timerExpected_us = deadline;
+            }
+        }
+    } else if (ep->timerNext_us < ep->timerInterval_us) {
+        /* lower next timer interval if changed by application */
         /* add one microsecond extra delay and make sure it is not zero */
         ep->timerNext_us += 1;
         if (ep->timerInterval_us < 1000000) {
@@ -200,9 +366,12 @@ CO_epoll_processLast(CO_epoll_t* ep) {
             ep->tm.it_value.tv_sec = ep->timerNext_us / 1000000;
             ep->tm.it_value.tv_nsec = (ep->timerNext_us % 1000000) * 1000;
         }
+        uint64_t now = clock_gettime_us();
         int ret = timerfd_settime(ep->timer_fd, 0, &ep->tm, NULL);
         if (ret < 0) {
             log_printf(LOG_DEBUG, DBG_ERRNO, "timerfd_settime");
+        } else {
+            ep->timerExpected_us = now + ep->timerNext_us;
         }
     }
 }
@@ -278,10 +447,39 @@ CO_epoll_processMain(CO_epoll_t* ep, CO_t* co, bool_t enableGateway, CO_NMT_rese
     /* process CANopen objects */
     *reset = CO_process(co, enableGateway, ep->timeDifference_us, &ep->timerNext_us);
 
+#if ((CO_CONFIG_TIME) & CO_CONFIG_TIME_ENABLE) && ((CO_CONFIG_TIME) & CO_CONFIG_TIME_PRODUCER)
+    /* TIME producer doesn't report timerNext_us, it sends in the pass after its timer reaches the interval */
+    CO_TIME_t* TIME = co->TIME;
+    if (TIME != NULL && TIME->isProducer && TIME->producerInterval_ms > 0) {
+        uint64_t timeNext_us = 0;
+        if (TIME->producerTimer_ms < TIME->producerInterval_ms) {
+            timeNext_us = (uint64_t)(TIME->producerInterval_ms - TIME->producerTimer_ms) * 1000;
+        }
+        if (ep->timerNext_us > timeNext_us) {
+            ep->timerNext_us = (uint32_t)timeNext_us;
+        }
+    }
+#endif
+
+    /* write CAN messages, staged during processing */
+    uint32_t txPending = CO_CANmodule_txFlush(co->CANmodule);
+
     /* If there are unsent CAN messages, call CO_CANmodule_process() earlier */
-    if (co->CANmodule->CANtxCount > 0 && ep->timerNext_us > CANSEND_DELAY_US) {
+    if ((co->CANmodule->CANtxCount > 0 || txPending > 0) && ep->timerNext_us > CANSEND_DELAY_US) {
         ep->timerNext_us = CANSEND_DELAY_US;
     }
+
+    /* Messages deferred by tx shaper are re-sent by CO_CANmodule_process(), when the next one has credit */
+    uint32_t shaperNext_us = CO_CANmodule_txShaperNext_us(co->CANmodule);
+    if (ep->timerNext_us > shaperNext_us) {
+        ep->timerNext_us = shaperNext_us;
+    }
+
+    /* Rx filters changed during processing are installed by CO_CANmodule_process() in the next pass */
+    uint32_t rxFiltersNext_us = CO_CANmodule_rxFiltersNext_us(co->CANmodule);
+    if (ep->timerNext_us > rxFiltersNext_us) {
+        ep->timerNext_us = rxFiltersNext_us;
+    }
 }
 
 /* CANrx and REALTIME *********************************************************/
@@ -291,10 +489,15 @@ CO_epoll_processRT(CO_epoll_t* ep, CO_t* co, bool_t realtime) {
         return;
     }
 
-    /* Verify for epoll events */
+    /* This thread owns CAN sockets, CO_CANsend() from other threads passes messages to it */
+    CO_CANmodule_txConsumer(co->CANmodule);
+
+    /* Verify for epoll events, all CAN sockets ready in this pass */
     if (ep->epoll_new) {
-        if (CO_CANrxFromEpoll(co->CANmodule, &ep->ev, NULL, NULL)) {
-            ep->epoll_new = false;
+        for (int i = 0; i < ep->eventCount; i++) {
+            if (ep->events[i].events != 0 && CO_CANrxFromEpoll(co->CANmodule, &ep->events[i], NULL, NULL)) {
+                ep->events[i].events = 0;
+            }
         }
     }
 
@@ -319,6 +522,9 @@ CO_epoll_processRT(CO_epoll_t* ep, CO_t* co, bool_t realtime) {
         }
         CO_UNLOCK_OD(co->CANmodule);
     }
+
+    /* write CAN messages, staged during processing, with single system call */
+    (void)CO_CANmodule_txFlush(co->CANmodule);
 }
 
 /* GATEWAY ********************************************************************/
@@ -345,14 +551,139 @@ gtwa_write_response(void* object, const char* buf, size_t count, uint8_t* connec
     return nWritten;
 }
 
+/* Append formatted text to response. After truncation len stays inside resp, so further appends are skipped. */
+static void
+gtwa_responseAppend(char* resp, size_t size, size_t* len, const char* format, ...) {
+    va_list args;
+    int n;
+
+    if (*len >= (size - 1)) {
+        return;
+    }
+    va_start(args, format);
+    n = vsnprintf(&resp[*len], size - *len, format, args);
+    va_end(args);
+    if (n > 0) {
+        *len += (size_t)n;
+        if (*len > (size - 1)) {
+            *len = size - 1;
+        }
+    }
+}
+
+/* Process driver specific command, which is not part of CiA309-3, before it is passed to gateway-ascii. Command must be
+ * one complete line: "[<sequence>] socketcan <command>". Return true, if command was processed. */
+static bool_t
+gtwa_driverCommand(CO_epoll_gtw_t* epGtw, CO_t* co, const char* buf, size_t count) {
+    char line[100];
+    char command[20];
+    char resp[1000];
+    size_t len = 0;
+    unsigned long sequence = 0;
+    uint8_t connectionOK = 1;
+
+    if (count == 0 || count >= sizeof(line) || buf[count - 1] != '\n') {
+        return false;
+    }
+    memcpy(line, buf, count);
+    line[count] = '\0';
+    if (sscanf(line, " [%lu] socketcan %19s", &sequence, command) != 2
+        && sscanf(line, " socketcan %19s", command) != 1) {
+        return false;
+    }
+
+    if (strcmp(command, "rxdrops") == 0) {
+        CO_CANmodule_t* CANmodule = co->CANmodule;
+        for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+            CO_CANinterface_t* interface = &CANmodule->CANinterfaces[i];
+            CO_CANrxDropStats_t stats;
+
+            (void)CO_CANmodule_getRxDrops(CANmodule, interface->can_ifindex, &stats);
+            gtwa_responseAppend(resp, sizeof(resp), &len, "[%lu] %s dropped=%u window(%ds)=%u alarm=%d\r\n",
+                                sequence, interface->ifName, stats.dropCount, CO_DRIVER_RX_DROP_WINDOW,
+                                stats.dropWindow, stats.alarm ? 1 : 0);
+        }
+    } else if (strcmp(command, "rxfilters") == 0) {
+        CO_CANmodule_t* CANmodule = co->CANmodule;
+        len = snprintf(resp, sizeof(resp), "[%lu] installs=%u pending=%d\r\n", sequence, CANmodule->rxFilterInstalls,
+                       CANmodule->rxFilterDirty ? 1 : 0);
+    } else if (strcmp(command, "txsync") == 0) {
+        len = snprintf(resp, sizeof(resp), "[%lu] purged=%u\r\n", sequence, co->CANmodule->txSyncPurged);
+    } else if (strcmp(command, "txlatency") == 0) {
+        CO_CANtxLatency_t latency;
+        uint16_t n;
+
+        /* one line per CAN identifier, response is written in parts */
+        for (n = 0; CO_CANmodule_getTxLatency(co->CANmodule, n, &latency); n++) {
+            if (len > (sizeof(resp) - 300U)) {
+                (void)gtwa_write_response(&epGtw->gtwa_fd, resp, len, &connectionOK);
+                len = 0;
+            }
+            gtwa_responseAppend(resp, sizeof(resp), &len, "[%lu] 0x%03X count=%u min=%uus avg=%uus max=%uus hist=",
+                                sequence, latency.ident, latency.count, latency.min_us,
+                                (uint32_t)(latency.sum_us / latency.count), latency.max_us);
+            for (uint32_t i = 0; i < CO_CAN_TX_LATENCY_BUCKETS; i++) {
+                gtwa_responseAppend(resp, sizeof(resp), &len, (i == 0) ? "%u" : ",%u", latency.histogram[i]);
+            }
+            gtwa_responseAppend(resp, sizeof(resp), &len, "\r\n");
+        }
+        if (n == 0) {
+            len = snprintf(resp, sizeof(resp), "[%lu] OK\r\n", sequence);
+        }
+    } else if (strcmp(command, "txshaper") == 0) {
+        CO_CANmodule_t* CANmodule = co->CANmodule;
+        for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+            CO_CANinterface_t* interface = &CANmodule->CANinterfaces[i];
+            CO_CANtxShaperStats_t stats;
+
+            if (CO_CANmodule_getTxShaper(CANmodule, interface->can_ifindex, &stats)) {
+                gtwa_responseAppend(resp, sizeof(resp), &len,
+                                    "[%lu] %s nmt=%u emcy=%u pdo=%u sdo=%u hb=%u other=%u load=%u\r\n", sequence,
+                                    interface->ifName, stats.deferred[CO_CAN_TX_CLASS_NMT],
+                                    stats.deferred[CO_CAN_TX_CLASS_EMCY], stats.deferred[CO_CAN_TX_CLASS_PDO],
+                                    stats.deferred[CO_CAN_TX_CLASS_SDO], stats.deferred[CO_CAN_TX_CLASS_HB],
+                                    stats.deferred[CO_CAN_TX_CLASS_OTHER], stats.loadDeferred);
+            }
+        }
+        if (len == 0) {
+            len = snprintf(resp, sizeof(resp), "[%lu] OK\r\n", sequence);
+        }
+    } else if (strcmp(command, "rtspin") == 0 && epGtw->epRT != NULL) {
+        uint32_t hits, misses;
+
+        CO_epoll_getStatistics(epGtw->epRT, NULL, &hits, &misses);
+        len = snprintf(resp, sizeof(resp), "[%lu] spin=%uus hits=%u misses=%u\r\n", sequence, epGtw->epRT->spin_us,
+                       hits, misses);
+    } else if (strcmp(command, "rtlatency") == 0 && epGtw->epRT != NULL) {
+        CO_epoll_latency_t latencyCopy;
+        const CO_epoll_latency_t* latency = &latencyCopy;
+
+        CO_epoll_getStatistics(epGtw->epRT, &latencyCopy, NULL, NULL);
+
+        len = snprintf(resp, sizeof(resp), "[%lu] count=%u overruns=%u min=%uus avg=%uus max=%uus hist=", sequence,
+                       latency->count, latency->overruns, (latency->count > 0) ? latency->min_us : 0,
+                       (latency->count > 0) ? (uint32_t)(latency->sum_us / latency->count) : 0, latency->max_us);
+        for (uint32_t i = 0; i < CO_EPOLL_LATENCY_BUCKETS; i++) {
+            gtwa_responseAppend(resp, sizeof(resp), &len, (i == 0) ? "%u" : ",%u", latency->histogram[i]);
+        }
+        gtwa_responseAppend(resp, sizeof(resp), &len, "\r\n");
+    } else {
+        /* CiA309-3: request not supported */
+        len = snprintf(resp, sizeof(resp), "[%lu] ERROR:100\r\n", sequence);
+    }
+
+    (void)gtwa_write_response(&epGtw->gtwa_fd, resp, len, &connectionOK);
+    return true;
+}
+
 static inline void
 socketAcceptEnableForEpoll(CO_epoll_gtw_t* epGtw) {
     struct epoll_event ev = {0};
     int ret;
 
     ev.events = EPOLLIN | EPOLLONESHOT;
-    ev.data.fd = epGtw->gtwa_fdSocket;
-    ret = epoll_ctl(epGtw->epoll_fd, EPOLL_CTL_MOD, ev.data.fd, &ev);
+    ev.data.ptr = &epGtw->socketHandler;
+    ret = epoll_ctl(epGtw->epoll_fd, EPOLL_CTL_MOD, epGtw->gtwa_fdSocket, &ev);
     if (ret < 0) {
         log_printf(LOG_CRIT, DBG_ERRNO, "epoll_ctl(gtwa_fdSocket)");
     }
@@ -375,6 +706,7 @@ CO_epoll_createGtw(CO_epoll_gtw_t* epGtw, int epoll_fd, int32_t commandInterface
                                                                                : (UINT_MAX - 1000000);
     epGtw->gtwa_fdSocket = -1;
     epGtw->gtwa_fd = -1;
+    epGtw->epRT = NULL;
 
     if (commandInterface == CO_COMMAND_IF_STDIO) {
         epGtw->gtwa_fd = STDIN_FILENO;
@@ -457,10 +789,17 @@ CO_epoll_createGtw(CO_epoll_gtw_t* epGtw, int epoll_fd, int32_t commandInterface
         epGtw->commandInterface = CO_COMMAND_IF_DISABLED;
     }
 
+    epGtw->socketHandler.fd = epGtw->gtwa_fdSocket;
+    epGtw->socketHandler.type = CO_EPOLL_HANDLER_GTW;
+    epGtw->socketHandler.object = epGtw;
+    epGtw->ioHandler.fd = epGtw->gtwa_fd;
+    epGtw->ioHandler.type = CO_EPOLL_HANDLER_GTW;
+    epGtw->ioHandler.object = epGtw;
+
     if (epGtw->gtwa_fd >= 0) {
         ev.events = EPOLLIN;
-        ev.data.fd = epGtw->gtwa_fd;
-        ret = epoll_ctl(epGtw->epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+        ev.data.ptr = &epGtw->ioHandler;
+        ret = epoll_ctl(epGtw->epoll_fd, EPOLL_CTL_ADD, epGtw->gtwa_fd, &ev);
         if (ret < 0) {
             log_printf(LOG_CRIT, DBG_ERRNO, "epoll_ctl(gtwa_fd)");
             return CO_ERROR_SYSCALL;
@@ -470,8 +809,8 @@ CO_epoll_createGtw(CO_epoll_gtw_t* epGtw, int epoll_fd, int32_t commandInterface
         /* prepare epoll for listening for new socket connection. After
          * connection will be accepted, fd for io operation will be defined. */
         ev.events = EPOLLIN | EPOLLONESHOT;
-        ev.data.fd = epGtw->gtwa_fdSocket;
-        ret = epoll_ctl(epGtw->epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+        ev.data.ptr = &epGtw->socketHandler;
+        ret = epoll_ctl(epGtw->epoll_fd, EPOLL_CTL_ADD, epGtw->gtwa_fdSocket, &ev);
         if (ret < 0) {
             log_printf(LOG_CRIT, DBG_ERRNO, "epoll_ctl(gtwa_fdSocket)");
             return CO_ERROR_SYSCALL;
@@ -516,91 +855,119 @@ CO_epoll_initCANopenGtw(CO_epoll_gtw_t* epGtw, CO_t* co) {
     epGtw->freshCommand = true;
 }
 
-void
-CO_epoll_processGtw(CO_epoll_gtw_t* epGtw, CO_t* co, CO_epoll_t* ep) {
-    if (epGtw == NULL || co == NULL || ep == NULL) {
-        return;
-    }
-
-    /* Verify for epoll events */
-    if (ep->epoll_new && (ep->ev.data.fd == epGtw->gtwa_fdSocket || ep->ev.data.fd == epGtw->gtwa_fd)) {
-        if ((ep->ev.events & EPOLLIN) != 0 && ep->ev.data.fd == epGtw->gtwa_fdSocket) {
-            bool_t fail = false;
+/* Process one line of data from gateway io stream or its beginning, if line is not closed with '\n' yet. Driver
+ * commands are processed here, other data is passed to gateway-ascii. spare is free space in gateway-ascii buffer. */
+static void
+gtwa_processLine(CO_epoll_gtw_t* epGtw, CO_t* co, const char* line, size_t count, size_t* spare) {
+    bool_t closed = (line[count - 1] == '\n'); /* is command closed? */
 
-            epGtw->gtwa_fd = accept4(epGtw->gtwa_fdSocket, NULL, NULL, SOCK_NONBLOCK);
-            if (epGtw->gtwa_fd < 0) {
-                fail = true;
-                if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                    log_printf(LOG_CRIT, DBG_ERRNO, "accept(gtwa_fdSocket)");
-                }
-            } else {
-                /* add fd to epoll */
-                struct epoll_event ev2 = {0};
-                ev2.events = EPOLLIN;
-                ev2.data.fd = epGtw->gtwa_fd;
-                int ret = epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, ev2.data.fd, &ev2);
-                if (ret < 0) {
-                    fail = true;
-                    log_printf(LOG_CRIT, DBG_ERRNO, "epoll_ctl(add, gtwa_fd)");
-                }
-                epGtw->socketTimeoutTmr_us = 0;
+    if (epGtw->freshCommand && gtwa_driverCommand(epGtw, co, line, count)) {
+        /* command was processed by the driver */
+    } else {
+        if (epGtw->commandInterface == CO_COMMAND_IF_STDIO) {
+            /* simplify command interface on stdio, make hard to type
+             * sequence optional, prepend "[0] " to string, if missing */
+            const char sequence[] = "[0] ";
+
+            if (line[0] != '[' && *spare >= strlen(sequence) && isgraph(line[0]) && line[0] != '#' && closed
+                && epGtw->freshCommand) {
+                CO_GTWA_write(co->gtwa, sequence, strlen(sequence));
+                *spare -= strlen(sequence);
             }
+        }
+        CO_GTWA_write(co->gtwa, line, count);
+    }
+    epGtw->freshCommand = closed;
+}
 
-            if (fail) {
-                socketAcceptEnableForEpoll(epGtw);
+/* Process epoll event of gateway socket or io stream */
+static void
+gtwa_processEvent(CO_epoll_gtw_t* epGtw, CO_t* co, CO_epoll_t* ep, const struct epoll_event* ev) {
+    if ((ev->events & EPOLLIN) != 0 && ev->data.ptr == &epGtw->socketHandler) {
+        bool_t fail = false;
+
+        epGtw->gtwa_fd = accept4(epGtw->gtwa_fdSocket, NULL, NULL, SOCK_NONBLOCK);
+        if (epGtw->gtwa_fd < 0) {
+            fail = true;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                log_printf(LOG_CRIT, DBG_ERRNO, "accept(gtwa_fdSocket)");
             }
-            ep->epoll_new = false;
-        } else if ((ep->ev.events & EPOLLIN) != 0 && ep->ev.data.fd == epGtw->gtwa_fd) {
-            char buf[CO_CONFIG_GTWA_COMM_BUF_SIZE];
-            size_t space = co->nodeIdUnconfigured ? CO_CONFIG_GTWA_COMM_BUF_SIZE : CO_GTWA_write_getSpace(co->gtwa);
-
-            ssize_t s = read(epGtw->gtwa_fd, buf, space);
-
-            if (space == 0 || co->nodeIdUnconfigured) {
-                /* continue or purge data */
-            } else if (s < 0 && errno != EAGAIN) {
-                log_printf(LOG_DEBUG, DBG_ERRNO, "read(gtwa_fd)");
-            } else if (s >= 0) {
-                if (epGtw->commandInterface == CO_COMMAND_IF_STDIO) {
-                    /* simplify command interface on stdio, make hard to type
-                     * sequence optional, prepend "[0] " to string, if missing */
-                    const char sequence[] = "[0] ";
-                    bool_t closed = (buf[s - 1] == '\n'); /* is command closed? */
-
-                    if (buf[0] != '[' && (space - s) >= strlen(sequence) && isgraph(buf[0]) && buf[0] != '#' && closed
-                        && epGtw->freshCommand) {
-                        CO_GTWA_write(co->gtwa, sequence, strlen(sequence));
-                    }
-                    epGtw->freshCommand = closed;
-                    CO_GTWA_write(co->gtwa, buf, s);
-                } else { /* socket, local or tcp */
-                    if (s == 0) {
-                        /* EOF received, close connection and enable socket
-                         * accepting */
-                        int ret = epoll_ctl(ep->epoll_fd, EPOLL_CTL_DEL, epGtw->gtwa_fd, NULL);
-                        if (ret < 0) {
-                            log_printf(LOG_CRIT, DBG_ERRNO, "epoll_ctl(del, gtwa_fd)");
-                        }
-                        if (close(epGtw->gtwa_fd) < 0) {
-                            log_printf(LOG_CRIT, DBG_ERRNO, "close(gtwa_fd)");
-                        }
-                        epGtw->gtwa_fd = -1;
-                        socketAcceptEnableForEpoll(epGtw);
-                    } else {
-                        CO_GTWA_write(co->gtwa, buf, s);
-                    }
-                }
+        } else {
+            /* add fd to epoll */
+            struct epoll_event ev2 = {0};
+            epGtw->ioHandler.fd = epGtw->gtwa_fd;
+            ev2.events = EPOLLIN;
+            ev2.data.ptr = &epGtw->ioHandler;
+            int ret = epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, epGtw->gtwa_fd, &ev2);
+            if (ret < 0) {
+                fail = true;
+                log_printf(LOG_CRIT, DBG_ERRNO, "epoll_ctl(add, gtwa_fd)");
             }
             epGtw->socketTimeoutTmr_us = 0;
+            epGtw->freshCommand = true;
+        }
 
-            ep->epoll_new = false;
-        } else if ((ep->ev.events & (EPOLLERR | EPOLLHUP)) != 0) {
-            log_printf(LOG_DEBUG, DBG_GENERAL, "socket error or hangup, event=", ep->ev.events);
+        if (fail) {
+            socketAcceptEnableForEpoll(epGtw);
+        }
+    } else if ((ev->events & EPOLLIN) != 0 && ev->data.ptr == &epGtw->ioHandler) {
+        char buf[CO_CONFIG_GTWA_COMM_BUF_SIZE];
+        size_t space = co->nodeIdUnconfigured ? CO_CONFIG_GTWA_COMM_BUF_SIZE : CO_GTWA_write_getSpace(co->gtwa);
+
+        ssize_t s = read(epGtw->gtwa_fd, buf, space);
+
+        if (space == 0 || co->nodeIdUnconfigured) {
+            /* continue or purge data */
+        } else if (s < 0 && errno != EAGAIN) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "read(gtwa_fd)");
+        } else if (s == 0 && epGtw->commandInterface != CO_COMMAND_IF_STDIO) {
+            /* EOF received on socket, local or tcp, close connection and enable socket accepting */
+            int ret = epoll_ctl(ep->epoll_fd, EPOLL_CTL_DEL, epGtw->gtwa_fd, NULL);
+            if (ret < 0) {
+                log_printf(LOG_CRIT, DBG_ERRNO, "epoll_ctl(del, gtwa_fd)");
+            }
             if (close(epGtw->gtwa_fd) < 0) {
-                log_printf(LOG_CRIT, DBG_ERRNO, "close(gtwa_fd, hangup)");
+                log_printf(LOG_CRIT, DBG_ERRNO, "close(gtwa_fd)");
+            }
+            epGtw->gtwa_fd = -1;
+            socketAcceptEnableForEpoll(epGtw);
+        } else if (s > 0) {
+            /* one read may contain several commands, each line is processed separately */
+            size_t spare = space - (size_t)s;
+            size_t start = 0;
+
+            while (start < (size_t)s) {
+                const char* nl = memchr(&buf[start], '\n', (size_t)s - start);
+                size_t count = (nl != NULL) ? (size_t)(nl - &buf[start]) + 1 : (size_t)s - start;
+
+                gtwa_processLine(epGtw, co, &buf[start], count, &spare);
+                start += count;
             }
         }
-    } /* if (ep->epoll_new) */
+        epGtw->socketTimeoutTmr_us = 0;
+    } else if ((ev->events & (EPOLLERR | EPOLLHUP)) != 0) {
+        log_printf(LOG_DEBUG, DBG_GENERAL, "socket error or hangup, event=", ev->events);
+        if (close(epGtw->gtwa_fd) < 0) {
+            log_printf(LOG_CRIT, DBG_ERRNO, "close(gtwa_fd, hangup)");
+        }
+    }
+}
+
+void
+CO_epoll_processGtw(CO_epoll_gtw_t* epGtw, CO_t* co, CO_epoll_t* ep) {
+    if (epGtw == NULL || co == NULL || ep == NULL) {
+        return;
+    }
+
+    /* Verify for epoll events */
+    for (int i = 0; ep->epoll_new && i < ep->eventCount; i++) {
+        struct epoll_event* ev = &ep->events[i];
+
+        if (ev->events != 0 && (ev->data.ptr == &epGtw->socketHandler || ev->data.ptr == &epGtw->ioHandler)) {
+            gtwa_processEvent(epGtw, co, ep, ev);
+            ev->events = 0;
+        }
+    }
 
     /* if socket connection is established, verify timeout */
     if (epGtw->socketTimeout_us > 0 && epGtw->gtwa_fdSocket > 0 && epGtw->gtwa_fd > 0) {
@@ -70,6 +70,35 @@ extern "C" {
  * processing. It can also trigger notification events in case of multi-thread operation.
  */
 
+/**
+ * Maximum number of epoll events, which are fetched with single epoll_wait() call inside @ref CO_epoll_wait().
+ *
+ * When CAN sockets, timer, eventfd and gateway are ready together, they are all served in the same pass through the
+ * processing functions. Macro is set to 8 by default. It can be overridden.
+ */
+#ifndef CO_EPOLL_EVENTS_MAX
+#define CO_EPOLL_EVENTS_MAX 8
+#endif
+
+/**
+ * Number of histogram buckets in @ref CO_epoll_latency_t.
+ */
+#define CO_EPOLL_LATENCY_BUCKETS 16
+
+/**
+ * Wakeup latency of timer in @ref CO_epoll_wait(): time from programmed timer expiration to return from epoll_wait().
+ */
+typedef struct {
+    uint32_t count;    /**< Number of measured timer wakeups */
+    uint32_t overruns; /**< Number of timer expirations, which passed without wakeup */
+    uint32_t min_us;   /**< Minimum latency in microseconds */
+    uint32_t max_us;   /**< Maximum latency in microseconds */
+    uint64_t sum_us;   /**< Sum of all latencies, for average */
+    /** Bucket i counts latencies from 2^i to 2^(i+1) microseconds. First bucket counts also latencies below 1 us, last
+     * bucket counts also longer latencies. */
+    uint32_t histogram[CO_EPOLL_LATENCY_BUCKETS];
+} CO_epoll_latency_t;
+
 /**
  * Object for epoll, timer and event API.
  */
@@ -84,8 +113,24 @@ typedef struct {
     bool_t timerEvent;          /**< True,if timer event is inside @ref CO_epoll_wait() */
     uint64_t previousTime_us;   /**< time value from the last process call in microseconds */
     struct itimerspec tm;       /**< Structure for timerfd */
-    struct epoll_event ev;      /**< Structure for epoll_wait */
-    bool_t epoll_new;           /**< true, if new epoll event is necessary to process */
+    bool_t tickless;            /**< True, if timerfd is armed only for the next deadline, see
+                                   @ref CO_epoll_setTickless() */
+    uint32_t timerIdle_us;      /**< Longest time between two @ref CO_epoll_wait() executions in tickless mode.
+                                   UINT32_MAX (no limit) after @ref CO_epoll_create(), may be set by application. */
+    uint64_t timerDeadline_us;  /**< Absolute deadline (CLOCK_MONOTONIC) armed in tickless mode, 0 if expired */
+    uint32_t spin_us;           /**< If not 0, @ref CO_epoll_wait() polls without sleeping this time before it blocks.
+                                   0 after @ref CO_epoll_create(), may be set by application. */
+    uint32_t spinHits;          /**< Number of @ref CO_epoll_wait() calls, where event arrived while spinning */
+    uint32_t spinMisses;        /**< Number of @ref CO_epoll_wait() calls, where spin time expired and wait blocked */
+    uint64_t timerExpected_us;  /**< Time (CLOCK_MONOTONIC) of next programmed timer expiration */
+    CO_epoll_latency_t latency; /**< Timer wakeup latency, always measured */
+    uint32_t statsSequence;     /**< Odd while spinHits, spinMisses or latency are updated, see
+                                   @ref CO_epoll_getStatistics() */
+    CO_epoll_handler_t eventHandler; /**< Handler of event_fd in epoll */
+    CO_epoll_handler_t timerHandler; /**< Handler of timer_fd in epoll */
+    struct epoll_event events[CO_EPOLL_EVENTS_MAX]; /**< Events from epoll_wait(), processed event has events = 0 */
+    int eventCount;             /**< Number of entries in events */
+    bool_t epoll_new;           /**< true, if some entry in events is not processed yet */
 } CO_epoll_t;
 
 /**
@@ -102,6 +147,27 @@ typedef struct {
  */
 CO_ReturnError_t CO_epoll_create(CO_epoll_t* ep, uint32_t timerInterval_us);
 
+/**
+ * Switch timerfd between periodic and tickless mode
+ *
+ * In periodic mode (default after @ref CO_epoll_create()) timerfd triggers every timerInterval_us, even if nothing has
+ * to be processed. In tickless mode timerfd is armed once for an absolute deadline: time of last
+ * @ref CO_epoll_wait() plus timerNext_us, as calculated by processing functions. timerNext_us starts from
+ * timerIdle_us, timerInterval_us is not used. @ref CO_epoll_processLast() re-arms timerfd only, if deadline moves
+ * earlier or has expired, so there is no syscall on passes where deadline does not change.
+ *
+ * Tickless mode is suitable for mainline: CANopen objects processed by @ref CO_epoll_processMain() and
+ * @ref CO_epoll_processGtw() report their timerNext_us and received messages wake mainline with callbacks. Application
+ * code, which is processed without reporting timerNext_us, must lower it itself or set timerIdle_us to its longest
+ * acceptable delay. Real-time thread, which relies on constant interval, should stay periodic.
+ *
+ * @param ep This object
+ * @param tickless True for tickless, false for periodic mode
+ *
+ * @return @ref CO_ReturnError_t CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or CO_ERROR_SYSCALL.
+ */
+CO_ReturnError_t CO_epoll_setTickless(CO_epoll_t* ep, bool_t tickless);
+
 /**
  * Close epoll, timerfd and eventfd
  *
@@ -110,21 +176,52 @@ CO_ReturnError_t CO_epoll_create(CO_epoll_t* ep, uint32_t timerInterval_us);
 void CO_epoll_close(CO_epoll_t* ep);
 
 /**
- * Wait for an epoll event
+ * Wait for epoll events
+ *
+ * This function blocks until event registered on epoll: timerfd, eventfd, or application specified event. Up to
+ * @ref CO_EPOLL_EVENTS_MAX ready events are fetched at once. Timerfd and eventfd are processed here, other events are
+ * processed by following processing functions. Function also calculates timeDifference_us since last call and prepares
+ * timerNext_us.
+ *
+ * On each timer event latency from programmed expiration is added to latency statistics. If timer expired more than
+ * once before it was read, missed expirations are counted as overruns.
+ *
+ * If spin_us is set (hybrid mode for real-time thread on isolated CPU core), epoll is first polled with zero timeout
+ * for spin_us, so events are served without sleep and wakeup latency. If no event arrives within that time, function
+ * blocks as usual. spinHits and spinMisses count both outcomes. Spin time should be shorter than timer interval,
+ * otherwise CPU is never released. For CAN sockets see also CO_CANptrSocketCan_t.rxBusyPoll_us.
  *
- * This function blocks until event registered on epoll: timerfd, eventfd, or application specified event. Function also
- * calculates timeDifference_us since last call and prepares timerNext_us.
+ * Each file descriptor in epoll must be registered with epoll_event.data.ptr pointing to its @ref CO_epoll_handler_t,
+ * which stays valid while fd is in epoll. Event is dispatched by this pointer. Application, which adds own file
+ * descriptors, uses handler type CO_EPOLL_HANDLER_APP. It processes own entries of events between CO_epoll_wait() and
+ * @ref CO_epoll_processLast() and sets their events field to 0.
  *
  * @param ep This object
  */
 void CO_epoll_wait(CO_epoll_t* ep);
 
+/**
+ * Get consistent copy of timer wakeup latency and spin statistics
+ *
+ * Statistics are updated by the thread, which calls @ref CO_epoll_wait(). This function may be called from any thread.
+ * It repeats the copy, if statistics were updated meanwhile.
+ *
+ * @param ep This object
+ * @param [out] latency Copy of latency, may be NULL.
+ * @param [out] spinHits Copy of spinHits, may be NULL.
+ * @param [out] spinMisses Copy of spinMisses, may be NULL.
+ */
+void CO_epoll_getStatistics(const CO_epoll_t* ep, CO_epoll_latency_t* latency, uint32_t* spinHits,
+                            uint32_t* spinMisses);
+
 /**
  * Closing function for an epoll event
  *
  * This function must be called after @ref CO_epoll_wait(). Between them should be application specified processing
  * functions, which can check for own events and do own processing. Application may also lower timerNext_us variable. If
- * lowered, then interval timer will be reconfigured and @ref CO_epoll_wait() will be triggered earlier.
+ * lowered, then interval timer will be reconfigured and @ref CO_epoll_wait() will be triggered earlier. In tickless
+ * mode timerfd is armed for the absolute deadline, see @ref CO_epoll_setTickless(). Events, which were not processed,
+ * are logged.
  *
  * @param ep This object
  */
@@ -196,6 +293,10 @@ typedef struct {
     int gtwa_fdSocket;            /**< Gateway socket file descriptor */
     int gtwa_fd;                  /**< Gateway io stream file descriptor */
     bool_t freshCommand;          /**< Indication of fresh command */
+    CO_epoll_handler_t socketHandler; /**< Handler of gtwa_fdSocket in epoll */
+    CO_epoll_handler_t ioHandler;     /**< Handler of gtwa_fd in epoll */
+    CO_epoll_t* epRT;             /**< Real-time thread epoll object for "socketcan rtspin", NULL after
+                                     @ref CO_epoll_createGtw(), may be set by application */
 } CO_epoll_gtw_t;
 
 /**
@@ -235,6 +336,17 @@ void CO_epoll_initCANopenGtw(CO_epoll_gtw_t* epGtw, CO_t* co);
  * This function checks for epoll events and verifies socket connection timeout. It is non-blocking and should execute
  * cyclically. It should be between @ref CO_epoll_wait() and @ref CO_epoll_processLast() functions.
  *
+ * Besides CiA309-3 commands, driver specific commands in form "[<sequence>] socketcan <command>" are processed:
+ * - "rxdrops": messages dropped on socket rx queue for each CAN interface, see CO_CANmodule_getRxDrops().
+ * - "rxfilters": number of rx filter installs into the kernel, see CO_CANmodule_rxFiltersBegin().
+ * - "txsync": number of synchronous messages removed from tx queues, see CO_CANclearPendingSyncPDOs().
+ * - "txlatency": latency statistics of tx messages for each CAN identifier, see CO_CANmodule_getTxLatency().
+ * - "txshaper": messages deferred by tx shaper for each CAN interface and traffic class, see
+ *   CO_CANmodule_getTxShaper().
+ * - "rtspin": spin hits and misses of real-time thread in hybrid mode, see @ref CO_epoll_wait(). Available, if epRT is
+ *   set.
+ * - "rtlatency": timer wakeup latency of real-time thread, see @ref CO_epoll_latency_t. Available, if epRT is set.
+ *
  * @param epGtw This object
  * @param co CANopen object
  * @param ep Pointer to @ref CO_epoll_t object.
@@ -33,9 +33,15 @@ extern "C" {
 #define CAN_BINDING_FAILED           "(%s) Binding CAN Interface \"%s\" failed", __func__
 #define CAN_ERROR_FILTER_FAILED      "(%s) Setting CAN Interface \"%s\" error filter failed", __func__
 #define CAN_FILTER_FAILED            "(%s) Setting CAN Interface \"%s\" message filter failed", __func__
+#define CAN_BPF_TOO_LONG             "(%s) BPF program for %d CAN filters too long, using CAN_RAW_FILTER", __func__
 #define CAN_NAMETOINDEX              "CAN Interface \"%s\" -> Index %d"
 #define CAN_SOCKET_BUF_SIZE          "CAN Interface \"%s\" RX buffer set to %d messages (%d Bytes)"
 #define CAN_RX_SOCKET_QUEUE_OVERFLOW "CAN Interface \"%s\" has lost %d messages"
+#define CAN_TIMESTAMP_SOURCE         "CAN Interface \"%s\" rx timestamp source: %s"
+#define CAN_TIMESTAMP_NO_HW          "CAN Interface \"%s\" does not support hardware timestamps"
+#define CAN_NO_FD_MTU                "CAN Interface \"%s\" has MTU %d, CAN FD frames can not be sent"
+#define CAN_TXTIME_FAILED            "CAN Interface \"%s\" does not support SO_TXTIME, messages are sent immediately"
+#define CAN_BUSY_POLL_FAILED         "CAN Interface \"%s\" SO_BUSY_POLL not set, socket receive does not busy poll"
 #define CAN_BUSOFF                   "CAN Interface \"%s\" changed to \"Bus Off\". Switching to Listen Only mode..."
 #define CAN_NOACK                    "CAN Interface \"%s\" no \"ACK\" received.  Switching to Listen Only mode..."
 #define CAN_RX_PASSIVE               "CAN Interface \"%s\" changed state to \"Rx Passive\""
@@ -73,11 +79,19 @@ extern "C" {
 #define DBG_NOT_TCP_PORT       "(%s) -c argument \"%s\" is not a valid tcp port", __func__
 #define DBG_WRONG_NODE_ID      "(%s) Wrong node ID \"%d\"", __func__
 #define DBG_WRONG_PRIORITY     "(%s) Wrong RT priority \"%d\"", __func__
+#define DBG_WRONG_DEADLINE     "(%s) Wrong RT runtime \"%u\", must be below %d us and without -p", __func__
+#define DBG_DEADLINE_AFFINITY  "(%s) RT runtime (-D) can not be used together with CPU pinning (-a, -A)", __func__
 #define DBG_NO_CAN_DEVICE      "(%s) Can't find CAN device \"%s\"", __func__
 #define DBG_STORAGE            "(%s) Error with storage \"%s\"", __func__
 #define DBG_OD_ENTRY           "(%s) Error in Object Dictionary entry: 0x%X", __func__
 #define DBG_CAN_OPEN           "(%s) CANopen error in %s, err=%d", __func__
 #define DBG_CAN_OPEN_INFO      "CANopen device, Node ID = 0x%02X, %s"
+#define DBG_RT_AFFINITY        "RT hardening: %s thread pinned to CPUs %s"
+#define DBG_RT_MLOCK           "RT hardening: memory locked, %dKB stack and %dKB heap prefaulted"
+#define DBG_RT_TIMERSLACK      "RT hardening: timer slack set to %d ns"
+#define DBG_RT_PRIORITY        "RT hardening: RT thread SCHED_FIFO priority %d"
+#define DBG_RT_DEADLINE        "RT hardening: RT thread SCHED_DEADLINE runtime %u us, period %d us"
+#define DBG_RT_LATENCY         "RT latency: count=%u overruns=%u min=%uus avg=%uus max=%uus hist=%s"
 
 /* CO_epoll_interface */
 #define DBG_EPOLL_UNKNOWN      "(%s) CAN Epoll error, events=0x%02x, fd=%d", __func__
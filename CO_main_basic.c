@@ -17,17 +17,24 @@
  * See the License for the specific language governing permissions and limitations under the License.
  */
 
+/* following macro is necessary for cpu_set_t and pthread_attr_setaffinity_np() */
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <sched.h>
+#include <malloc.h>
 #include <signal.h>
 #include <errno.h>
 #include <stdarg.h>
 #include <syslog.h>
 #include <time.h>
 #include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
 #include <net/if.h>
 #include <linux/reboot.h>
 #include <sys/reboot.h>
@@ -55,6 +62,26 @@
 #ifndef TMR_THREAD_INTERVAL_US
 #define TMR_THREAD_INTERVAL_US 1000
 #endif
+/* Stack and heap size, which is touched at startup with -m, so later use causes no page faults */
+#ifndef PREFAULT_STACK_SIZE
+#define PREFAULT_STACK_SIZE (256 * 1024)
+#endif
+#ifndef PREFAULT_HEAP_SIZE
+#define PREFAULT_HEAP_SIZE (1024 * 1024)
+#endif
+/* If 1, mainline timer is armed only for the next deadline reported by CANopen objects, see CO_epoll_setTickless(). */
+#ifndef MAIN_THREAD_TICKLESS
+#define MAIN_THREAD_TICKLESS 1
+#endif
+/* Longest idle time of tickless mainline in microseconds. Application doesn't report its next deadline, so
+ * app_programAsync() is then still called at least every MAIN_THREAD_INTERVAL_US. */
+#ifndef MAIN_THREAD_IDLE_US
+#ifdef CO_USE_APPLICATION
+#define MAIN_THREAD_IDLE_US MAIN_THREAD_INTERVAL_US
+#else
+#define MAIN_THREAD_IDLE_US UINT32_MAX
+#endif
+#endif
 
 /* default values for CO_CANopenInit() */
 #ifndef NMT_CONTROL
@@ -131,6 +158,112 @@ sigHandler(int sig) {
     CO_endProgram = 1;
 }
 
+/* SIGUSR1 handler, latency statistics are logged from mainline */
+static volatile sig_atomic_t CO_logLatency = 0;
+
+static void
+sigUsr1Handler(int sig) {
+    (void)sig;
+    CO_logLatency = 1;
+}
+
+/* Log timer wakeup latency of thread, which processes real-time objects. It may run in other thread. */
+static void
+logLatency(const CO_epoll_t* ep) {
+    CO_epoll_latency_t latencyCopy;
+    const CO_epoll_latency_t* latency = &latencyCopy;
+    char hist[CO_EPOLL_LATENCY_BUCKETS * 11];
+    size_t len = 0;
+
+    CO_epoll_getStatistics(ep, &latencyCopy, NULL, NULL);
+    for (uint32_t i = 0; i < CO_EPOLL_LATENCY_BUCKETS; i++) {
+        len += snprintf(&hist[len], sizeof(hist) - len, (i == 0) ? "%u" : ",%u", latency->histogram[i]);
+    }
+    log_printf(LOG_NOTICE, DBG_RT_LATENCY, latency->count, latency->overruns,
+               (latency->count > 0) ? latency->min_us : 0,
+               (latency->count > 0) ? (uint32_t)(latency->sum_us / latency->count) : 0, latency->max_us, hist);
+}
+
+/* Parse CPU list, for example "1,3-4", into cpu set. Return false, if list is not valid. */
+static bool_t
+parseCpuList(const char* str, cpu_set_t* set) {
+    CPU_ZERO(set);
+    while (*str != '\0') {
+        char* end;
+        unsigned long first = strtoul(str, &end, 10);
+        unsigned long last = first;
+
+        if (end == str) {
+            return false;
+        }
+        if (*end == '-') {
+            str = end + 1;
+            last = strtoul(str, &end, 10);
+            if (end == str) {
+                return false;
+            }
+        }
+        if (last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (; first <= last; first++) {
+            CPU_SET(first, set);
+        }
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return false;
+        }
+        str = end;
+    }
+    return CPU_COUNT(set) > 0;
+}
+
+/* Touch pages of stack below the caller */
+static void
+prefaultStack(void) {
+    volatile uint8_t stack[PREFAULT_STACK_SIZE];
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    for (size_t i = 0; i < sizeof(stack); i += page) {
+        stack[i] = 0;
+    }
+}
+
+/* Lock current and future memory, prefault stack and heap and minimize timer slack. Threads created later inherit
+ * timer slack and their stacks are locked and populated by MCL_FUTURE. */
+static bool_t
+lockMemory(void) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uint8_t* heap;
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        log_printf(LOG_CRIT, DBG_ERRNO, "mlockall()");
+        return false;
+    }
+    /* freed heap must stay in process and large blocks must not be mapped separately, so prefaulted pages are reused */
+    (void)mallopt(M_TRIM_THRESHOLD, -1);
+    (void)mallopt(M_MMAP_MAX, 0);
+    heap = malloc(PREFAULT_HEAP_SIZE);
+    if (heap == NULL) {
+        log_printf(LOG_CRIT, DBG_ERRNO, "malloc(prefault)");
+        return false;
+    }
+    for (size_t i = 0; i < PREFAULT_HEAP_SIZE; i += page) {
+        heap[i] = 0;
+    }
+    free(heap);
+    prefaultStack();
+    log_printf(LOG_INFO, DBG_RT_MLOCK, PREFAULT_STACK_SIZE / 1024, PREFAULT_HEAP_SIZE / 1024);
+
+    if (prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL) != 0) {
+        log_printf(LOG_CRIT, DBG_ERRNO, "prctl(PR_SET_TIMERSLACK)");
+        return false;
+    }
+    log_printf(LOG_INFO, DBG_RT_TIMERSLACK, 1);
+    return true;
+}
+
 /* Message logging function */
 void
 log_printf(int priority, const char* format, ...) {
@@ -220,9 +353,40 @@ printUsage(char* progName) {
            "  -i <Node ID>        CANopen Node-id (1..127) or 0xFF (LSS unconfigured).\n");
 #ifndef CO_SINGLE_THREAD
     printf("  -p <RT priority>    Real-time priority of RT thread (1 .. 99). If not set or\n"
-           "                      set to -1, then normal scheduler is used for RT thread.\n");
+           "                      set to -1, then normal scheduler is used for RT thread.\n"
+           "  -S <us>[:<us>]      Hybrid mode of RT thread for isolated CPU core: poll for\n"
+           "                      events this time before sleeping. Optional second value\n"
+           "                      sets SO_BUSY_POLL on CAN sockets. See \"socketcan rtspin\".\n"
+           "  -a <CPU list>       Pin RT thread to CPUs, for example \"3\" or \"2-3\".\n"
+           "  -D <runtime us>     Run RT thread with SCHED_DEADLINE, this runtime in each RT\n"
+           "                      interval (%d us). Can not be used together with -p, -a\n"
+           "                      or -A.\n",
+           TMR_THREAD_INTERVAL_US);
 #endif
+    printf("  -A <CPU list>       Pin mainline thread to CPUs, for example \"0-1,4\".\n"
+           "  -m                  Lock memory (mlockall), prefault stack and heap and set\n"
+           "                      timer slack to 1 ns.\n");
     printf("  -r                  Enable reboot on CANopen NMT reset_node command. \n");
+    printf("  -t <source>         Source of CAN rx timestamps: \"auto\" (default), \"sw\",\n"
+           "                      \"hw\" (adapter clock synchronized to system clock) or\n"
+           "                      \"raw-hw\" (free running adapter clock). \"auto\" uses\n"
+           "                      \"raw-hw\", if supported by the CAN interface.\n");
+    printf("  -b <bytes>          Size of CAN socket rx buffer (SO_RCVBUF). SO_RCVBUFFORCE\n"
+           "                      is used, if privileged. Kernel default, if not set.\n"
+           "  -B <bytes>          Enable adaptive CAN socket rx buffer: size doubles on each\n"
+           "                      rx queue overflow up to this size.\n");
+    printf("  -f                  Compile CAN rx filters into BPF program (SO_ATTACH_FILTER)\n"
+           "                      instead of CAN_RAW_FILTER list.\n");
+    printf("  -l                  Measure latency of CAN tx messages with tx timestamps, see\n"
+           "                      \"socketcan txlatency\" command.\n");
+    printf("  -o <us>             Launch synchronous TPDOs this time after SYNC (SO_TXTIME).\n"
+           "                      ETF qdisc with CLOCK_TAI must be set on CAN interface.\n");
+    printf("  -R <class>:<rate>[:<burst>]  Limit CAN tx messages of traffic class to rate\n"
+           "                      per second, burst messages may be sent at once. Class is\n"
+           "                      \"nmt\", \"emcy\", \"pdo\", \"sdo\", \"hb\" or \"other\". Option\n"
+           "                      may repeat, see \"socketcan txshaper\" command.\n");
+    printf("  -L <percent>@<kbit/s>  Limit bus load of CAN tx messages. Above it SDO and\n"
+           "                      other low priority messages wait.\n");
 #if (CO_CONFIG_STORAGE) & CO_CONFIG_STORAGE_ENABLE
     printf("  -s <storage path>   Path and filename prefix for data storage files.\n"
            "                      By default files are stored in current dictionary.\n");
@@ -255,7 +419,14 @@ main(int argc, char* argv[]) {
 #ifndef CO_SINGLE_THREAD
     pthread_t rt_thread_id;
     int rtPriority = -1;
+    uint32_t rtSpin_us = 0;
+    uint32_t rtRuntime_us = 0; /* SCHED_DEADLINE runtime of RT thread, 0 if not used */
+    char* rtCpuList = NULL;
+    cpu_set_t rtCpus;
 #endif
+    char* mainCpuList = NULL;
+    cpu_set_t mainCpus;
+    bool_t memoryLock = false;
     CO_NMT_reset_cmd_t reset = CO_RESET_NOT;
     CO_ReturnError_t err;
     CO_CANptrSocketCan_t CANptr = {0};
@@ -307,7 +478,7 @@ main(int argc, char* argv[]) {
         printUsage(argv[0]);
         exit(EXIT_SUCCESS);
     }
-    while ((opt = getopt(argc, argv, "i:p:rc:T:s:")) != -1) {
+    while ((opt = getopt(argc, argv, "i:p:S:a:D:A:mrt:b:B:flo:R:L:c:T:s:")) != -1) {
         switch (opt) {
             case 'i': {
                 long int nodeIdLong = strtol(optarg, NULL, 0);
@@ -316,8 +487,87 @@ main(int argc, char* argv[]) {
             }
 #ifndef CO_SINGLE_THREAD
             case 'p': rtPriority = strtol(optarg, NULL, 0); break;
+            case 'S': {
+                unsigned int spin = 0, busyPoll = 0;
+                if (sscanf(optarg, "%u:%u", &spin, &busyPoll) < 1) {
+                    log_printf(LOG_CRIT, DBG_ARGUMENT_UNKNOWN, "-S", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                rtSpin_us = spin;
+                CANptr.rxBusyPoll_us = (int)busyPoll;
+                break;
+            }
+            case 'a': {
+                rtCpuList = optarg;
+                if (!parseCpuList(optarg, &rtCpus)) {
+                    log_printf(LOG_CRIT, DBG_ARGUMENT_UNKNOWN, "-a", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'D': rtRuntime_us = strtoul(optarg, NULL, 0); break;
 #endif
+            case 'A': {
+                mainCpuList = optarg;
+                if (!parseCpuList(optarg, &mainCpus)) {
+                    log_printf(LOG_CRIT, DBG_ARGUMENT_UNKNOWN, "-A", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'm': memoryLock = true; break;
             case 'r': rebootEnable = true; break;
+            case 'b': CANptr.rxBufferSize = strtol(optarg, NULL, 0); break;
+            case 'B': CANptr.rxBufferSizeMax = strtol(optarg, NULL, 0); break;
+            case 'f': CANptr.rxFilterBpf = true; break;
+            case 'l': CANptr.txLatency = true; break;
+            case 'o': CANptr.txTimeOffset_us = strtoul(optarg, NULL, 0); break;
+            case 'R': {
+                static const char* const classNames[CO_CAN_TX_CLASS_COUNT] = {"nmt", "emcy", "pdo",
+                                                                              "sdo", "hb",   "other"};
+                char name[10];
+                unsigned int rate = 0, burst = 0;
+                int c;
+                int nMatch = sscanf(optarg, "%9[a-z]:%u:%u", name, &rate, &burst);
+
+                for (c = 0; c < CO_CAN_TX_CLASS_COUNT && nMatch >= 2; c++) {
+                    if (strcmp(name, classNames[c]) == 0) {
+                        break;
+                    }
+                }
+                if (nMatch < 2 || c == CO_CAN_TX_CLASS_COUNT) {
+                    log_printf(LOG_CRIT, DBG_ARGUMENT_UNKNOWN, "-R", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                CANptr.txClassRate[c] = rate;
+                CANptr.txClassBurst[c] = burst;
+                break;
+            }
+            case 'L': {
+                unsigned int percent = 0, kbit = 0;
+                if (sscanf(optarg, "%u@%u", &percent, &kbit) != 2 || percent == 0 || percent > 100) {
+                    log_printf(LOG_CRIT, DBG_ARGUMENT_UNKNOWN, "-L", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                CANptr.txLoadMax = (uint8_t)percent;
+                CANptr.txBitRate = kbit * 1000U;
+                break;
+            }
+            case 't': {
+                if (strcmp(optarg, "auto") == 0) {
+                    CANptr.timestamp = CO_CAN_TIMESTAMP_AUTO;
+                } else if (strcmp(optarg, "sw") == 0) {
+                    CANptr.timestamp = CO_CAN_TIMESTAMP_SW;
+                } else if (strcmp(optarg, "hw") == 0) {
+                    CANptr.timestamp = CO_CAN_TIMESTAMP_HW;
+                } else if (strcmp(optarg, "raw-hw") == 0) {
+                    CANptr.timestamp = CO_CAN_TIMESTAMP_HW_RAW;
+                } else {
+                    log_printf(LOG_CRIT, DBG_ARGUMENT_UNKNOWN, "-t", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
 #if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
             case 'c': {
                 const char* comm_stdio = "stdio";
@@ -385,6 +635,18 @@ main(int argc, char* argv[]) {
         printUsage(argv[0]);
         exit(EXIT_FAILURE);
     }
+    /* SCHED_DEADLINE replaces SCHED_FIFO, runtime must fit into RT interval */
+    if (rtRuntime_us > 0 && (rtPriority != -1 || rtRuntime_us > TMR_THREAD_INTERVAL_US)) {
+        log_printf(LOG_CRIT, DBG_WRONG_DEADLINE, rtRuntime_us, TMR_THREAD_INTERVAL_US);
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    /* kernel refuses SCHED_DEADLINE for thread, which is not allowed to run on all CPUs of its root domain */
+    if (rtRuntime_us > 0 && (rtCpuList != NULL || mainCpuList != NULL)) {
+        log_printf(LOG_CRIT, DBG_DEADLINE_AFFINITY);
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
 #endif
 
     if (CANptr.can_ifindex == 0) {
@@ -394,6 +656,18 @@ main(int argc, char* argv[]) {
 
     log_printf(LOG_INFO, DBG_CAN_OPEN_INFO, mlStorage.pendingNodeId, "starting");
 
+    /* RT hardening of mainline thread, RT thread inherits it */
+    if (mainCpuList != NULL) {
+        if (sched_setaffinity(0, sizeof(mainCpus), &mainCpus) != 0) {
+            log_printf(LOG_CRIT, DBG_ERRNO, "sched_setaffinity(main)");
+            exit(EXIT_FAILURE);
+        }
+        log_printf(LOG_INFO, DBG_RT_AFFINITY, "mainline", mainCpuList);
+    }
+    if (memoryLock && !lockMemory()) {
+        exit(EXIT_FAILURE);
+    }
+
     /* Allocate memory for CANopen objects */
     uint32_t heapMemoryUsed = 0;
     CO_config_t* config_ptr = NULL;
@@ -467,6 +741,10 @@ main(int argc, char* argv[]) {
         log_printf(LOG_CRIT, DBG_ERRNO, "signal(SIGTERM, sigHandler)");
         exit(EXIT_FAILURE);
     }
+    if (signal(SIGUSR1, sigUsr1Handler) == SIG_ERR) {
+        log_printf(LOG_CRIT, DBG_ERRNO, "signal(SIGUSR1, sigUsr1Handler)");
+        exit(EXIT_FAILURE);
+    }
 
     /* get current time for CO_TIME_set(), since January 1, 1984, UTC. */
     struct timespec ts;
@@ -485,12 +763,19 @@ main(int argc, char* argv[]) {
         log_printf(LOG_CRIT, DBG_GENERAL, "CO_epoll_create(main), err=", err);
         exit(EXIT_FAILURE);
     }
+    err = CO_epoll_setTickless(&epMain, MAIN_THREAD_TICKLESS);
+    if (err != CO_ERROR_NO) {
+        log_printf(LOG_CRIT, DBG_GENERAL, "CO_epoll_setTickless(main), err=", err);
+        exit(EXIT_FAILURE);
+    }
+    epMain.timerIdle_us = MAIN_THREAD_IDLE_US;
 #ifndef CO_SINGLE_THREAD
     err = CO_epoll_create(&epRT, TMR_THREAD_INTERVAL_US);
     if (err != CO_ERROR_NO) {
         log_printf(LOG_CRIT, DBG_GENERAL, "CO_epoll_create(RT), err=", err);
         exit(EXIT_FAILURE);
     }
+    epRT.spin_us = rtSpin_us;
     CANptr.epoll_fd = epRT.epoll_fd;
 #else
     CANptr.epoll_fd = epMain.epoll_fd;
@@ -501,6 +786,12 @@ main(int argc, char* argv[]) {
         log_printf(LOG_CRIT, DBG_GENERAL, "CO_epoll_createGtw(), err=", err);
         exit(EXIT_FAILURE);
     }
+#ifndef CO_SINGLE_THREAD
+    epGtw.epRT = &epRT;
+#else
+    /* mainline processes also real-time objects */
+    epGtw.epRT = &epMain;
+#endif
 #endif
 
     while (reset != CO_RESET_APP && reset != CO_RESET_QUIT && CO_endProgram == 0) {
@@ -608,13 +899,31 @@ main(int argc, char* argv[]) {
             firstRun = false;
             CO_TIME_set(CO->TIME, time_ms, time_days, TIME_STAMP_INTERVAL_MS);
 #ifndef CO_SINGLE_THREAD
-            /* Create rt_thread and set priority */
-            if (pthread_create(&rt_thread_id, NULL, rt_thread, NULL) != 0) {
-                log_printf(LOG_CRIT, DBG_ERRNO, "pthread_create(rt_thread)");
+            /* Create rt_thread, pinned to CPUs from its start, and set priority */
+            pthread_attr_t rtAttr;
+            int rtCreated = -1;
+
+            if (pthread_attr_init(&rtAttr) != 0) {
+                log_printf(LOG_CRIT, DBG_ERRNO, "pthread_attr_init(rt_thread)");
+            } else {
+                if (rtCpuList != NULL && pthread_attr_setaffinity_np(&rtAttr, sizeof(rtCpus), &rtCpus) != 0) {
+                    log_printf(LOG_CRIT, DBG_ERRNO, "pthread_attr_setaffinity_np(RT)");
+                } else {
+                    rtCreated = pthread_create(&rt_thread_id, &rtAttr, rt_thread, &rtRuntime_us);
+                    if (rtCreated != 0) {
+                        log_printf(LOG_CRIT, DBG_ERRNO, "pthread_create(rt_thread)");
+                    }
+                }
+                (void)pthread_attr_destroy(&rtAttr);
+            }
+            if (rtCreated != 0) {
                 programExit = EXIT_FAILURE;
                 CO_endProgram = 1;
                 continue;
             }
+            if (rtCpuList != NULL) {
+                log_printf(LOG_INFO, DBG_RT_AFFINITY, "RT", rtCpuList);
+            }
             if (rtPriority > 0) {
                 struct sched_param param;
 
@@ -625,6 +934,7 @@ main(int argc, char* argv[]) {
                     CO_endProgram = 1;
                     continue;
                 }
+                log_printf(LOG_INFO, DBG_RT_PRIORITY, rtPriority);
             }
 #endif
         } /* if(firstRun) */
@@ -667,17 +977,16 @@ main(int argc, char* argv[]) {
             CO_epoll_processGtw(&epGtw, CO, &epMain);
 #endif
             CO_epoll_processMain(&epMain, CO, GATEWAY_ENABLE, &reset);
-            CO_epoll_processLast(&epMain);
-
-#ifdef CO_USE_APPLICATION
-            /* Execute optional external application code */
-            app_programAsync(CO, epMain.timeDifference_us);
-#endif
 
 #if (CO_CONFIG_STORAGE) & CO_CONFIG_STORAGE_ENABLE
-            /* don't save more often than interval */
+            /* don't save more often than interval, wake tickless mainline for it */
             if (storageIntervalTimer < CO_STORAGE_AUTO_INTERVAL) {
                 storageIntervalTimer += epMain.timeDifference_us;
+            }
+            if (storageIntervalTimer < CO_STORAGE_AUTO_INTERVAL) {
+                if (epMain.timerNext_us > CO_STORAGE_AUTO_INTERVAL - storageIntervalTimer) {
+                    epMain.timerNext_us = CO_STORAGE_AUTO_INTERVAL - storageIntervalTimer;
+                }
             } else {
                 uint32_t mask = CO_storageLinux_auto_process(&storage, false);
                 if (mask != storageErrorPrev && !CO->nodeIdUnconfigured) {
@@ -689,7 +998,26 @@ main(int argc, char* argv[]) {
                 }
                 storageErrorPrev = mask;
                 storageIntervalTimer = 0;
+                if (epMain.timerNext_us > CO_STORAGE_AUTO_INTERVAL) {
+                    epMain.timerNext_us = CO_STORAGE_AUTO_INTERVAL;
+                }
+            }
+#endif
+            CO_epoll_processLast(&epMain);
+
+            if (CO_logLatency != 0) {
+                CO_logLatency = 0;
+#ifndef CO_SINGLE_THREAD
+                logLatency(&epRT);
+#else
+                logLatency(&epMain);
+#endif
             }
+
+#ifdef CO_USE_APPLICATION
+            /* Execute optional external application code, tickless mainline is woken at least every
+             * MAIN_THREAD_IDLE_US */
+            app_programAsync(CO, epMain.timeDifference_us);
 #endif
         }
     } /* while(reset != CO_RESET_APP */
@@ -738,12 +1066,46 @@ main(int argc, char* argv[]) {
 }
 
 #ifndef CO_SINGLE_THREAD
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+/* Argument of sched_setattr() system call, which has no glibc wrapper */
+struct rt_sched_attr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
 /*******************************************************************************
  * Realtime thread for CAN receive and threadTmr
  ******************************************************************************/
 static void*
 rt_thread(void* arg) {
-    (void)arg;
+    uint32_t runtime_us = *(uint32_t*)arg;
+
+    /* SCHED_DEADLINE with runtime_us in each RT interval, set by thread itself */
+    if (runtime_us > 0) {
+        struct rt_sched_attr attr = {0};
+
+        attr.size = sizeof(attr);
+        attr.sched_policy = SCHED_DEADLINE;
+        attr.sched_runtime = (uint64_t)runtime_us * 1000;
+        attr.sched_deadline = (uint64_t)TMR_THREAD_INTERVAL_US * 1000;
+        attr.sched_period = attr.sched_deadline;
+        if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0) {
+            log_printf(LOG_CRIT, DBG_ERRNO, "sched_setattr(SCHED_DEADLINE)");
+            CO_endProgram = 1;
+            return NULL;
+        }
+        log_printf(LOG_INFO, DBG_RT_DEADLINE, runtime_us, TMR_THREAD_INTERVAL_US);
+    }
+
     /* Endless loop */
     while (CO_endProgram == 0) {
 